@@ -1,46 +1,369 @@
 import socket
 import json
+import select
+import collections
 import struct
 import time
+import zlib
+import numpy as np
+from multiprocessing import shared_memory
+
+# Binary frame layout, must match environment/Public/EnvWireFormat.h
+FRAME_MAGIC = 0x46425253  # b"SRBF"
+FRAME_VERSION = 1
+FRAME_HEADER = struct.Struct('<IBBHI')   # magic, version, kind, flags, count
+STEP_RECORD = struct.Struct('<ffII')     # reward, delta_time, done, obs_len
+KIND_STEP = 1
+KIND_TRAJECTORY = 2
+KIND_BATCH = 3
+KIND_SLOT_NOTICE = 4
+KIND_STREAM = 5
+
+# Shared-memory ring, must match environment/Public/EnvSharedMemory.h
+RING_MAGIC = 0x4D535253   # b"SRSM"
+RING_HEADER = struct.Struct('<IB3xIIII')  # magic, version, slot_count, obs_capacity, slot_stride, reserved
+RING_HEADER_SIZE = 64
+SLOT_NOTICE = struct.Struct('<IB3x')      # first_slot, reply_kind
+
+# Packed observation grid (FlagPackedGrid), must match EnvWire::FPackedGrid
+FLAG_PACKED_GRID = 1
+PACKED_GRID = struct.Struct('<IHBx')      # grid_len, count, mode
+GRID_BITMAP = 0
+GRID_SPARSE = 1
+
+# Optional per-reply server timings (FlagTimingBlock), must match EnvWire::FTimingBlock
+FLAG_TIMING_BLOCK = 2
+TIMING_BLOCK = struct.Struct('<6I')
+TIMING_FIELDS = ("recv_us", "queue_us", "execute_us", "wake_us", "prev_encode_us", "prev_send_us")
+
+# Compressed batches (FlagCompressed), must match EnvWire::FCompressedBlock
+FLAG_COMPRESSED = 4
+COMPRESSED_BLOCK = struct.Struct('<IB3x') # raw_size, codec
+CODEC_ZLIB = 1
+
+# Auto-reset batches (FlagAutoReset): every done record is followed by the next episode's first record
+FLAG_AUTO_RESET = 8
+
+# Episode summaries (FlagEpisodeStats): every done record is followed by an EnvWire::FEpisodeSummary,
+# before its reset record
+FLAG_EPISODE_STATS = 16
+EPISODE_SUMMARY = struct.Struct('<fIIIIffHBx')
+EPISODE_FIELDS = ('return', 'length', 'hits', 'shots', 'fire_blocked', 'time_to_first_hit', 'duration', 'env', 'truncated')
+
+# Stream mode frames, must match EnvWire::FStreamInfo
+STREAM_INFO = struct.Struct('<QQII')      # tick, action_tick, superseded, skipped_frames
+
+def parse_endpoint(endpoint, host='127.0.0.1', port=7777):
+    """Split an endpoint string (same forms as environment/Public/EnvEndpoint.h) into
+    ('unix', path, None) or ('tcp', host, port). Bare hosts/ports fill in from the defaults.
+    """
+    endpoint = str(endpoint)
+    if endpoint.startswith('unix:'):
+        path = endpoint[5:]
+        return 'unix', path[2:] if path.startswith('//') else path, None
+    if endpoint.startswith('tcp://'):
+        endpoint = endpoint[6:]
+    if ':' in endpoint:
+        host, _, p = endpoint.rpartition(':')
+        return 'tcp', host, int(p)
+    return 'tcp', host, int(endpoint)
+
 
 class UE5SocketClient:
-    def __init__(self, host='127.0.0.1', port=7777, timeout=5.0, retry_delay=1.0):
-        """Keep retrying until the UE5 server is listening."""
+    def __init__(self, host='127.0.0.1', port=7777, timeout=5.0, retry_delay=1.0, encoding='binary', obs_encoding='packed', timing=False, endpoint=None,
+                 compression=None, compress_threshold=None, auto_reset=False, episode_stats=False, action_repeat=1):
+        """Keep retrying until the UE5 server is listening.
+
+        endpoint: optional "tcp://host:port" or "unix:///path/to.sock", overriding host/port.
+        A Unix domain socket skips the TCP/IP stack (same host, Linux/Mac engines only).
+
+        encoding: 'binary' asks the server for raw float32 frames on reset/step,
+        'json' keeps the original text replies. 'shm' additionally maps the server's shared-memory
+        ring so observations skip the socket entirely (same host only).
+        Older servers fall back to binary or JSON on their own.
+
+        obs_encoding: 'packed' lets binary frames carry the peripheral grid as a bitmap or a
+        sparse hit list (whichever the server finds smaller), 'float' keeps plain float32.
+
+        timing: ask the server to attach its per-phase timings to every reply (under "timing",
+        see last_timing). Aggregated histograms are always available through stats().
+
+        compression: 'zlib' lets the server compress step_n / vec_* replies whose body is at least
+        compress_threshold bytes (server default 16 KiB). Worth it when the trainer sits on another
+        machine; on the same host it only costs CPU. Binary encodings only.
+
+        auto_reset: the server resets an env in place when a step ends its episode, so step_n /
+        vec_step keep going past done and the fresh episode's first observation comes back in the
+        same reply (see reset_obs) instead of costing a reset() round trip.
+
+        episode_stats: done steps carry the server's summary of the episode they ended (see
+        episode). Not available over shm; episode_stats() drains the same summaries either way.
+
+        action_repeat: every step holds its action for this many engine ticks (frame-skip), stopping
+        early on done. The reward comes back summed over those ticks, delta_time covers all of them,
+        and only the last observation is sent. Applies to step, step_n and vec_step.
+        """
         self.sock = None
+        self.shm = None
+        self.obs_encoding = 'float'
+        self.last_timing = None
+        # auto-reset: first obs of the next episode for a terminal step(), or one entry per
+        # batch record (None unless that record was done)
+        self.reset_obs = None
+        # episode_stats: summary dict for a terminal step(), or one entry per batch record
+        self.episode = None
+        self._packed_out = np.empty((0, 0), dtype=np.float32)
+        # stream frames that arrived while we were waiting for a reply
+        self._stream_frames = collections.deque(maxlen=4096)
+        kind, host, port = parse_endpoint(endpoint, host, port) if endpoint else ('tcp', host, port)
+        where = host if kind == 'unix' else f"{host}:{port}"
         while self.sock is None:
             try:
-                print(f"[UE5SocketClient] Attempting to connect to {host}:{port}...")
-                self.sock = socket.create_connection((host, port), timeout)
+                print(f"[UE5SocketClient] Attempting to connect to {where}...")
+                self.sock = self._connect(kind, host, port, timeout)
             except Exception as e:
                 print(f"[UE5SocketClient] Connection failed ({e}), retrying in {retry_delay}s")
                 time.sleep(retry_delay)
         self.sock.settimeout(None)
-        print("[UE5SocketClient] TCP connection acquired. Initializing RL networks...")
+        if kind == 'tcp':
+            self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.compression = 'none'
+        self.auto_reset = False
+        self.episode_piggyback = False
+        self.action_repeat = 1
+        self.encoding = self._negotiate(encoding, obs_encoding, timing, compression, compress_threshold, auto_reset,
+                                        episode_stats, action_repeat)
+        print(f"[UE5SocketClient] {kind.upper()} connection acquired ({self.encoding} replies). Initializing RL networks...")
+
+    @staticmethod
+    def _connect(kind, host, port, timeout):
+        if kind == 'tcp':
+            return socket.create_connection((host, port), timeout)
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            sock.settimeout(timeout)
+            sock.connect(host)
+        except Exception:
+            sock.close()
+            raise
+        return sock
+
+    def _negotiate(self, encoding, obs_encoding='float', timing=False, compression=None, compress_threshold=None,
+                   auto_reset=False, episode_stats=False, action_repeat=1):
+        if encoding == 'json' and not timing and not auto_reset and not episode_stats and action_repeat == 1:
+            return 'json'
+        hello = {"cmd": "hello", "encoding": encoding, "obs_encoding": obs_encoding, "timing": bool(timing)}
+        if auto_reset:
+            hello["auto_reset"] = True
+        if episode_stats:
+            hello["episode_stats"] = True
+        if action_repeat != 1:
+            hello["action_repeat"] = int(action_repeat)
+        if compression:
+            hello["compression"] = compression
+            if compress_threshold is not None:
+                hello["compress_threshold"] = int(compress_threshold)
+        r = self._send(hello)
+        self.obs_encoding = r.get("obs_encoding", "float")
+        self.compression = r.get("compression", "none")
+        self.auto_reset = bool(r.get("auto_reset", False))
+        self.episode_piggyback = bool(r.get("episode_stats", False))
+        self.action_repeat = int(r.get("action_repeat", 1))
+        # servers without "hello" reply with an empty object -> stay on JSON
+        negotiated = r.get("encoding", "json")
+        if negotiated == "shm":
+            self._open_ring(r["shm_name"])
+        return negotiated
+
+    def _open_ring(self, name):
+        try:
+            self.shm = shared_memory.SharedMemory(name=name, track=False)
+        except TypeError:
+            # Python < 3.13: attaching registers with the resource tracker, which would unlink the server's region
+            from multiprocessing import resource_tracker
+            self.shm = shared_memory.SharedMemory(name=name)
+            resource_tracker.unregister(self.shm._name, "shared_memory")
+        magic, _, self.ring_slots, _, self.ring_stride, _ = RING_HEADER.unpack_from(self.shm.buf, 0)
+        if magic != RING_MAGIC:
+            raise ConnectionError(f"Unexpected shared-memory ring (magic={magic:#x})")
 
     def _recv_n_bytes(self, n):
-        buf = b''
-        while len(buf) < n:
-            chunk = self.sock.recv(n - len(buf))
-            if not chunk:
+        buf = bytearray(n)
+        view = memoryview(buf)
+        got = 0
+        while got < n:
+            k = self.sock.recv_into(view[got:], n - got)
+            if k == 0:
                 raise ConnectionError("Socket closed")
-            buf += chunk
+            got += k
         return buf
 
-    def _send(self, msg: dict) -> dict:
-        # send the request
+    def _post(self, msg: dict):
         data = json.dumps(msg).encode('utf-8')
         self.sock.sendall(struct.pack('<I', len(data)) + data)
 
+    def _recv_frame(self) -> dict:
         # read response length + payload
         raw_len = self._recv_n_bytes(4)
         resp_len = struct.unpack('<I', raw_len)[0]
         resp_bytes = self._recv_n_bytes(resp_len)
-        resp = json.loads(resp_bytes.decode('utf-8'))
+        if resp_bytes[:1] != b'{':
+            return self._decode_frame(resp_bytes)
+        return json.loads(resp_bytes.decode('utf-8'))
+
+    def _send(self, msg: dict) -> dict:
+        self._post(msg)
+
+        # in stream mode, frames pushed by the engine can arrive ahead of the reply
+        resp = self._recv_frame()
+        while "tick" in resp:
+            self._stream_frames.append(resp)
+            resp = self._recv_frame()
+        self.last_timing = resp.get("timing", self.last_timing)
 
         return resp
 
-    def reset(self):
-        r = self._send({"cmd": "reset"})
+    def _decode_frame(self, buf):
+        magic, version, kind, flags, count = FRAME_HEADER.unpack_from(buf, 0)
+        if magic != FRAME_MAGIC or version != FRAME_VERSION:
+            raise ConnectionError(f"Unexpected frame (magic={magic:#x}, version={version})")
+        offset = FRAME_HEADER.size
+        if flags & FLAG_COMPRESSED:
+            # the body decodes exactly like an uncompressed frame's, just from offset 0
+            raw_size, codec = COMPRESSED_BLOCK.unpack_from(buf, offset)
+            if codec != CODEC_ZLIB:
+                raise ConnectionError(f"Unknown frame codec {codec}")
+            buf = zlib.decompress(memoryview(buf)[offset + COMPRESSED_BLOCK.size:], bufsize=raw_size)
+            offset = 0
+        obs, rewards, dones, dts = [], [], [], []
+        reset_obs = [] if flags & FLAG_AUTO_RESET else None
+        episodes = [] if flags & FLAG_EPISODE_STATS else None
+        timing = None
+        stream = None
+        if kind == KIND_STREAM:
+            stream = STREAM_INFO.unpack_from(buf, offset)
+            offset += STREAM_INFO.size
+        if kind != KIND_SLOT_NOTICE and flags & FLAG_TIMING_BLOCK:
+            timing = dict(zip(TIMING_FIELDS, TIMING_BLOCK.unpack_from(buf, offset)))
+            offset += TIMING_BLOCK.size
+        if kind == KIND_SLOT_NOTICE:
+            # records live in the ring; copy them out before the server reuses the slots
+            first_slot, kind = SLOT_NOTICE.unpack_from(buf, offset)
+            slot = first_slot
+            for i in range(count):
+                reward, delta_time, done, o = self._read_slot(slot)
+                slot += 1
+                obs.append(o)
+                rewards.append(reward)
+                dones.append(bool(done))
+                dts.append(delta_time)
+                if reset_obs is not None:
+                    # a done record's reset record takes the next slot
+                    reset_obs.append(self._read_slot(slot)[3] if done else None)
+                    slot += bool(done)
+        else:
+            for i in range(count):
+                reward, delta_time, done, obs_len = STEP_RECORD.unpack_from(buf, offset)
+                offset += STEP_RECORD.size
+                if flags & FLAG_PACKED_GRID:
+                    o, offset = self._unpack_grid(buf, offset, obs_len, i, count)
+                else:
+                    o = np.frombuffer(buf, dtype='<f4', count=obs_len, offset=offset)
+                    offset += 4 * obs_len
+                obs.append(o)
+                rewards.append(reward)
+                dones.append(bool(done))
+                dts.append(delta_time)
+                if episodes is not None:
+                    if done:
+                        episodes.append(self._episode_dict(EPISODE_SUMMARY.unpack_from(buf, offset)))
+                        offset += EPISODE_SUMMARY.size
+                    else:
+                        episodes.append(None)
+                if reset_obs is not None:
+                    if done:
+                        # decoded into a spare row and copied, the next reset record reuses it
+                        _, _, _, obs_len = STEP_RECORD.unpack_from(buf, offset)
+                        offset += STEP_RECORD.size
+                        if flags & FLAG_PACKED_GRID:
+                            o, offset = self._unpack_grid(buf, offset, obs_len, count, count + 1)
+                            o = o.copy()
+                        else:
+                            o = np.frombuffer(buf, dtype='<f4', count=obs_len, offset=offset)
+                            offset += 4 * obs_len
+                        reset_obs.append(o)
+                    else:
+                        reset_obs.append(None)
+
+        if kind in (KIND_TRAJECTORY, KIND_BATCH):
+            r = {"count": count, "obs": obs, "reward": rewards, "done": dones, "delta_time": dts}
+        elif stream is not None:
+            # stream frames get queued, so they can't share the reused unpack buffer
+            r = {"obs": np.array(obs[0]), "reward": rewards[0], "done": dones[0], "delta_time": dts[0],
+                 "tick": stream[0], "action_tick": stream[1], "superseded": stream[2], "skipped_frames": stream[3]}
+        else:
+            r = {"obs": obs[0], "reward": rewards[0], "done": dones[0], "delta_time": dts[0]}
+        if reset_obs is not None:
+            r["reset_obs"] = reset_obs if kind in (KIND_TRAJECTORY, KIND_BATCH) else reset_obs[0]
+        if episodes is not None:
+            if kind in (KIND_TRAJECTORY, KIND_BATCH):
+                r["episodes"] = episodes
+            elif episodes[0] is not None:
+                r["episode"] = episodes[0]
+        if timing is not None:
+            r["timing"] = timing
+        return r
+
+    @staticmethod
+    def _episode_dict(values):
+        """FEpisodeSummary fields under the same keys as the JSON replies."""
+        summary = dict(zip(EPISODE_FIELDS, values))
+        summary["truncated"] = bool(summary["truncated"])
+        return summary
+
+    def _read_slot(self, slot):
+        offset = RING_HEADER_SIZE + (slot % self.ring_slots) * self.ring_stride
+        reward, delta_time, done, obs_len = STEP_RECORD.unpack_from(self.shm.buf, offset)
+        o = np.frombuffer(self.shm.buf, dtype='<f4', count=obs_len, offset=offset + STEP_RECORD.size).copy()
+        return reward, delta_time, done, o
+
+    def _unpack_grid(self, buf, offset, obs_len, row, rows):
+        """Expands one packed observation into row `row` of a reused [rows, obs_len] buffer.
+
+        The returned view is only valid until the next request; callers that keep it must copy.
+        """
+        if self._packed_out.shape[0] < rows or self._packed_out.shape[1] != obs_len:
+            self._packed_out = np.empty((max(rows, self._packed_out.shape[0]), obs_len), dtype=np.float32)
+        out = self._packed_out[row]
+
+        grid_len, n_hits, mode = PACKED_GRID.unpack_from(buf, offset)
+        offset += PACKED_GRID.size
+        grid = out[:grid_len]
+        if mode == GRID_SPARSE:
+            grid.fill(0.0)
+            grid[np.frombuffer(buf, dtype='<u2', count=n_hits, offset=offset)] = 1.0
+            offset += 2 * n_hits
+        else:
+            n_bytes = (grid_len + 7) // 8
+            bits = np.frombuffer(buf, dtype=np.uint8, count=n_bytes, offset=offset)
+            grid[:] = np.unpackbits(bits, count=grid_len, bitorder='little')
+            offset += n_bytes
+
+        n_scalars = obs_len - grid_len
+        out[grid_len:] = np.frombuffer(buf, dtype='<f4', count=n_scalars, offset=offset)
+        return out, offset + 4 * n_scalars
+
+    def _env_cmd(self, msg, env):
+        """Sends a single-env request, aimed at instance "Env<env>" when env isn't 0."""
+        if env:
+            msg["env"] = int(env)
+        r = self._send(msg)
+        if r.get("status") == "error" and "num_envs" in r:
+            raise ValueError(f"No env instance {env} (the world has {r['num_envs']})")
+        return r
+
+    def reset(self, env=0):
+        r = self._env_cmd({"cmd": "reset"}, env)
         return (
             r.get("obs"),
             r.get("reward"),
@@ -48,8 +371,11 @@ class UE5SocketClient:
             r.get("delta_time", 0.0)
         )
 
-    def step(self, pitch, yaw, fire_flag):
-        r = self._send({"cmd": "step", "action": [pitch, yaw, fire_flag]})
+    def step(self, pitch, yaw, fire_flag, env=0):
+        r = self._env_cmd({"cmd": "step", "action": [pitch, yaw, fire_flag]}, env)
+        # JSON replies only carry reset_obs on done steps
+        self.reset_obs = r.get("reset_obs") if r.get("done") else None
+        self.episode = r.get("episode")
         return (
             r.get("obs"),
             r.get("reward"),
@@ -57,6 +383,138 @@ class UE5SocketClient:
             r.get("delta_time", 0.0)
         )
 
+    def step_n(self, actions=None, action=None, repeat=1, env=0):
+        """Run a whole segment in one round trip, one action per engine tick.
+
+        Pass either a list of [pitch, yaw, fire_flag] actions, or a single action plus a repeat count.
+        The server stops early on done, so the returned arrays can be shorter than requested.
+        reset / step / step_n all drive env instance `env` (see vec_step for all of them at once).
+        """
+        if actions is not None:
+            msg = {"cmd": "step_n", "actions": [list(map(float, a)) for a in actions]}
+        else:
+            msg = {"cmd": "step_n", "action": list(map(float, action)), "repeat": int(repeat)}
+        return self._unpack_batch(self._env_cmd(msg, env))
+
+    def vec_reset(self):
+        """Reset every env instance served by this engine; returns arrays with one row per env."""
+        return self._unpack_batch(self._send({"cmd": "vec_reset"}))
+
+    def vec_step(self, actions):
+        """Step all K env instances on the same tick with a [K, 3] batch of [pitch, yaw, fire_flag]."""
+        r = self._send({"cmd": "vec_step", "actions": [list(map(float, a)) for a in actions]})
+        if r.get("status") == "error":
+            raise ValueError(f"vec_step needs one action per env ({r.get('num_envs')} envs, got {len(actions)})")
+        return self._unpack_batch(r)
+
+    def _unpack_batch(self, r):
+        if self.auto_reset:
+            # JSON batches send an empty row for records that weren't done
+            self.reset_obs = [o if d else None for o, d in zip(r.get("reset_obs") or [], r.get("done"))]
+        self.episode = r.get("episodes")
+        return (
+            np.asarray(r.get("obs"), dtype=np.float32),
+            np.asarray(r.get("reward"), dtype=np.float32),
+            np.asarray(r.get("done"), dtype=bool),
+            np.asarray(r.get("delta_time"), dtype=np.float32)
+        )
+
+    def sync(self, enabled=True, fixed_dt=1.0 / 60.0, ticks_per_step=1, render=False):
+        """Switch the server to lock-step: the world advances exactly ticks_per_step fixed ticks per step
+        request and otherwise waits for us, so there's no need to throttle on the Python side.
+        """
+        r = self._send({"cmd": "sync", "enabled": bool(enabled), "fixed_dt": float(fixed_dt),
+                        "ticks_per_step": int(ticks_per_step), "render": bool(render)})
+        return r.get("sync", False)
+
+    def snapshot(self, slot=0, seed=None, env=0, on_reset=False):
+        """Record the world state of env instance `env` (tagged actors, agent aim, RNG seed) into `slot`.
+
+        on_reset makes every later reset, auto-resets included, restore this slot instead of the
+        default spawn state. Returns the server's reply ({"status", "slot", "actors", "seed"}).
+        """
+        msg = {"cmd": "snapshot", "slot": int(slot), "env": int(env), "on_reset": bool(on_reset)}
+        if seed is not None:
+            msg["seed"] = int(seed)
+        return self._send(msg)
+
+    def restore(self, slot=0, env=0):
+        """Reset straight into a snapshot ("reset to state X"). Same return value as reset()."""
+        r = self._send({"cmd": "restore", "slot": int(slot), "env": int(env)})
+        if r.get("status") == "error":
+            raise KeyError(f"No snapshot in slot {slot} for env {env}")
+        return (
+            r.get("obs"),
+            r.get("reward"),
+            r.get("done"),
+            r.get("delta_time", 0.0)
+        )
+
+    def set_time_dilation(self, dilation):
+        """Run the sim `dilation` times faster (or slower) than real time. Every env timer runs on
+        simulated time, so the dynamics per simulated second don't change; delta_time keeps reporting
+        simulated seconds. Returns the factor the server actually applied (UE clamps it, 20x by default).
+        """
+        return self._send({"cmd": "set_time_dilation", "dilation": float(dilation)}).get("time_dilation", 1.0)
+
+    def episode_stats(self):
+        """Summaries of every episode finished (or cut short by a reset) on any env instance since
+        the last call: a list of dicts with env, return, length, hits, shots, fire_blocked,
+        time_to_first_hit (-1 without a hit), duration (sim seconds) and truncated. Also returns how
+        many summaries the server had to overwrite because they weren't drained in time.
+        """
+        r = self._send({"cmd": "episode_stats"})
+        return r.get("episodes", []), r.get("dropped", 0)
+
+    def stats(self, reset=False):
+        """Server-side latency histograms: {cmd: {phase: {count, mean_us, p50_us, p99_us, ...}}}."""
+        return self._send({"cmd": "stats", "reset": bool(reset)}).get("stats", {})
+
+    def stream_start(self):
+        """Switch to stream mode: the engine pushes one observation per tick (read them with
+        recv_stream) and takes actions through act() without replying, so the sim keeps running
+        while the policy thinks. Other commands such as reset() keep working in between.
+        Stream frames are always binary, even on a JSON or shm connection.
+        """
+        self._stream_frames.clear()
+        return self._send({"cmd": "stream", "enabled": True}).get("stream", False)
+
+    def stream_stop(self):
+        r = self._send({"cmd": "stream", "enabled": False})
+        self._stream_frames.clear()
+        return not r.get("stream", True)
+
+    def act(self, tick, pitch, yaw, fire_flag):
+        """Send an action answering stream frame `tick`. The engine applies the newest action it has
+        on its next tick and reports that tick id back as action_tick in the frame after.
+        """
+        self._post({"cmd": "act", "tick": int(tick), "action": [float(pitch), float(yaw), int(fire_flag)]})
+
+    def recv_stream(self, latest=False):
+        """Next stream frame: dict with obs, reward, done, delta_time, tick, action_tick (0 = no
+        action applied), superseded and skipped_frames.
+
+        latest=True skips ahead to the newest frame already received; the reward of the skipped
+        frames is summed into it and done is OR-ed, so nothing the agent should learn from is lost.
+        """
+        frame = self._next_stream_frame()
+        if latest:
+            reward, done = frame["reward"], frame["done"]
+            while self._stream_frames or select.select([self.sock], [], [], 0)[0]:
+                frame = self._next_stream_frame()
+                reward += frame["reward"]
+                done = done or frame["done"]
+            frame["reward"], frame["done"] = reward, done
+        return frame
+
+    def _next_stream_frame(self):
+        if self._stream_frames:
+            return self._stream_frames.popleft()
+        frame = self._recv_frame()
+        if "tick" not in frame:
+            raise ConnectionError("Unexpected reply while waiting for a stream frame")
+        return frame
+
     def pause(self):
         """Pause the UE5 simulation."""
         r = self._send({"cmd": "pause"})
@@ -68,6 +526,9 @@ class UE5SocketClient:
         return r.get("status") == "resumed"
 
     def close(self):
+        if self.shm is not None:
+            self.shm.close()
+            self.shm = None
         try:
             self.sock.shutdown(socket.SHUT_RDWR)
         except:
@@ -24,25 +24,55 @@ class UE5Env(gym.Env):
         periph_h=27,
         periph_w=41,
         visualization_interval=1,
+        sync_mode=False,
+        fixed_dt=1.0 / 60.0,
+        ticks_per_step=1,
+        render_world=True,
+        endpoint=None,
+        auto_reset=False,
+        time_dilation=1.0,
+        env_index=0,
+        episode_stats=False,
+        action_repeat=1,
     ):
         super().__init__()
         self.periph_h = periph_h
         self.periph_w = periph_w
 
+        # which "Env<K>" turret of a multi-agent world this env drives (0 = the local player's)
+        self.env_index = env_index
         self.visualization_interval = max(1, visualization_interval)
         self._step_counter = 0
         self._last_obs = None
-        # Initialize a default dt of 1/60s
-        self._last_dt = 1.0 / 60.0
+        # auto-reset: the next episode's first obs, handed out by the next reset() without an RPC
+        self._pending_reset_obs = None
+        # episode_stats: the server's summary of the last finished episode (return, length, hits, ...)
+        self.last_episode = None
+        # Initialize a default dt of 1/60s per tick; _last_dt spans the whole (repeated) step
+        self._last_dt = action_repeat / 60.0
 
         self.pitch_low, self.pitch_high = pitch_range
         self.yaw_low,   self.yaw_high   = yaw_range
 
-        self.client = UE5SocketClient(host=host, port=port)
+        # endpoint ("tcp://host:port" or "unix:///path.sock") takes precedence over host/port
+        self.client = UE5SocketClient(host=host, port=port, endpoint=endpoint, auto_reset=auto_reset,
+                                      episode_stats=episode_stats, action_repeat=action_repeat)
+        # Frame-skip: the engine applies each action on this many ticks, see UE5SocketClient
+        self.action_repeat = self.client.action_repeat
         time.sleep(0.5)
 
+        # Lock-step: the engine waits for each step, so no wall-clock throttling below
+        self.sync_mode = sync_mode and self.client.sync(True, fixed_dt, ticks_per_step, render_world)
+        # Sim seconds per real second; delta_time stays in sim seconds, only the throttle below shrinks
+        self.time_dilation = 1.0
+        if time_dilation != 1.0:
+            self.time_dilation = self.client.set_time_dilation(time_dilation)
+
+        if self.sync_mode:
+            self._last_dt = fixed_dt * ticks_per_step * self.time_dilation * self.action_repeat
+
         # Warm up and grab an initial dt (optional)
-        obs, _, _, new_dt = self.client.reset()
+        obs, _, _, new_dt = self.client.reset(env=self.env_index)
         if new_dt > 0.0:
             self._last_dt = new_dt
         obs = np.array(obs, dtype=np.float32)
@@ -73,10 +103,14 @@ class UE5Env(gym.Env):
 
     def reset(self, *, seed=None, options=None):
         super().reset(seed=seed)
-        obs, _, done, new_dt = self.client.reset()
-        if new_dt > 0.0:
-            self._last_dt = new_dt
-        obs = np.array(obs, dtype=np.float32)
+        if self._pending_reset_obs is not None:
+            obs = np.array(self._pending_reset_obs, dtype=np.float32)
+            self._pending_reset_obs = None
+        else:
+            obs, _, done, new_dt = self.client.reset(env=self.env_index)
+            if new_dt > 0.0:
+                self._last_dt = new_dt
+            obs = np.array(obs, dtype=np.float32)
 
         self._step_counter = 0
         self._last_obs = obs.copy()
@@ -91,16 +125,20 @@ class UE5Env(gym.Env):
         yaw_rate   = float(np.clip(cont[1], self.yaw_low,   self.yaw_high))
         fire_flag  = int(action["discrete"])
 
-        # compute per-tick delta angles
-        exec_pitch = pitch_rate * self._last_dt
-        exec_yaw   = yaw_rate   * self._last_dt
+        # compute per-tick delta angles (with action repeat the engine applies them on every repeated tick)
+        exec_pitch = pitch_rate * self._last_dt / self.action_repeat
+        exec_yaw   = yaw_rate   * self._last_dt / self.action_repeat
 
         #  SINGLE RPC call 
-        obs, reward, done, new_dt = self.client.step(exec_pitch, exec_yaw, fire_flag)
+        obs, reward, done, new_dt = self.client.step(exec_pitch, exec_yaw, fire_flag, env=self.env_index)
         self._last_dt = new_dt
+        if done:
+            self._pending_reset_obs = self.client.reset_obs
+            self.last_episode = self.client.episode
 
         #throttle to ue5 tickrate
-        time.sleep(self._last_dt)
+        if not self.sync_mode:
+            time.sleep(self._last_dt / self.time_dilation)
 
         #  standard post-processing 
         obs = np.array(obs, dtype=np.float32)
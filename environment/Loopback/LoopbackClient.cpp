@@ -0,0 +1,629 @@
+// LoopbackClient.cpp
+//
+// Load generator for the env protocol. Connects to loopback_server (or a running editor session),
+// negotiates an encoding, drives reset / step / step_n / vec_step in a closed loop and prints
+// env steps per second plus p50/p99 request latency. Every reply is decoded back into float
+// observations and checked, so a protocol change that breaks a layout fails the run.
+//
+//   loopback_client [--endpoint tcp://127.0.0.1:7777 | --port 7777] [--encoding json|binary|shm] [--obs float|packed]
+//                   [--compression none|zlib] [--compress-threshold BYTES] [--auto-reset] [--episode-stats]
+//                   [--action-repeat K]
+//                   [--mode step|step_n|vec_step] [--batch N] [--requests N] [--warmup N]
+//   loopback_client --sweep [--endpoint E] [--requests N]
+//
+// Steps/sec only counts time spent inside the timed requests; the resets issued when an episode
+// ends are not part of the measurement.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "LoopbackCommon.h"
+#include "MockEnv.h"
+#include "EnvEndpoint.h"
+#include "EnvSharedMemory.h"
+#include "EnvTelemetry.h"
+#include "EnvWireFormat.h"
+
+namespace
+{
+    struct FRunConfig
+    {
+        std::string Encoding = "binary";
+        std::string ObsEncoding = "float";
+        std::string Compression = "none";
+        int CompressThreshold = -1;  // server default
+        bool bAutoReset = false;
+        bool bEpisodeStats = false;
+        int ActionRepeat = 1;
+        std::string Mode = "step";
+        int Batch = 1;
+        int Requests = 2000;
+        int Warmup = 200;
+    };
+
+    struct FRunResult
+    {
+        uint64_t Steps = 0;
+        uint64_t BusyMicros = 0;
+        uint64_t ReplyBytes = 0;
+        EnvTelemetry::FLatencyHistogram Latency;
+    };
+
+    /** One decoded transition; its observation sits in the client's reused Obs buffer at the same index. */
+    struct FDecoded
+    {
+        float Reward = 0.0f;
+        bool  Done = false;
+        float DeltaTime = 0.0f;
+    };
+
+    [[noreturn]] void Fail(const char* What)
+    {
+        std::fprintf(stderr, "loopback_client: %s\n", What);
+        std::exit(1);
+    }
+}
+
+class FLoopbackClient
+{
+public:
+    explicit FLoopbackClient(const EnvEndpoint::FEndpoint& InEndpoint) : Endpoint(InEndpoint) {}
+    ~FLoopbackClient() { Disconnect(); }
+
+    void Connect(const FRunConfig& Config)
+    {
+        // The server may still be starting up
+        int Attempts = 0;
+        while ((Fd = ConnectOnce()) < 0)
+        {
+            if (++Attempts > 50)
+                Fail("could not connect to the server");
+            usleep(100 * 1000);
+        }
+        if (Endpoint.Kind == EnvEndpoint::EKind::Tcp)
+            Loopback::SetNoDelay(Fd);
+
+        Request = "{\"cmd\":\"hello\",\"encoding\":\"" + Config.Encoding + "\",\"obs_encoding\":\"" + Config.ObsEncoding +
+            "\",\"compression\":\"" + Config.Compression + "\",\"timing\":false" +
+            ",\"auto_reset\":" + (Config.bAutoReset ? "true" : "false") +
+            ",\"episode_stats\":" + (Config.bEpisodeStats ? "true" : "false") +
+            ",\"action_repeat\":" + std::to_string(Config.ActionRepeat) +
+            (Config.CompressThreshold >= 0 ? ",\"compress_threshold\":" + std::to_string(Config.CompressThreshold) : std::string()) + "}";
+        const Loopback::FJson Reply = RoundTripJson();
+        NegotiatedEncoding = Reply.GetString("encoding");
+        NegotiatedCompression = Reply.GetString("compression");
+        bAutoReset = Reply.GetBool("auto_reset", false);
+        if (NegotiatedEncoding == "shm")
+            OpenRing(Reply.GetString("shm_name"));
+    }
+
+    int ConnectOnce() const
+    {
+        if (Endpoint.Kind == EnvEndpoint::EKind::Unix)
+            return EnvEndpoint::ConnectUnix(Endpoint.Path);
+
+        sockaddr_in Addr = {};
+        Addr.sin_family = AF_INET;
+        Addr.sin_port = htons(Endpoint.Port);
+        if (inet_pton(AF_INET, Endpoint.Host, &Addr.sin_addr) != 1)
+            Fail("endpoint host must be an IPv4 address");
+
+        const int NewFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(NewFd, reinterpret_cast<sockaddr*>(&Addr), sizeof(Addr)) != 0)
+        {
+            close(NewFd);
+            return -1;
+        }
+        return NewFd;
+    }
+
+    void Disconnect()
+    {
+        if (RingBase)
+        {
+            munmap(RingBase, RingSize);
+            RingBase = nullptr;
+        }
+        if (Fd >= 0)
+        {
+            close(Fd);
+            Fd = -1;
+        }
+    }
+
+    const std::string& GetNegotiatedEncoding() const { return NegotiatedEncoding; }
+    const std::string& GetNegotiatedCompression() const { return NegotiatedCompression; }
+
+    void Run(const FRunConfig& Config, FRunResult& Out)
+    {
+        // vec_step needs one action row per server-side instance, so learn K first
+        ResetFor(Config);
+        const int Batch = Config.Mode == "vec_step" ? NumEnvs : Config.Batch;
+
+        for (int i = 0; i < Config.Warmup + Config.Requests; ++i)
+        {
+            BuildStepRequest(Config.Mode, Batch, i);
+
+            const uint64_t Start = Loopback::NowMicros();
+            const size_t Count = RoundTripRecords();
+            const uint64_t Micros = Loopback::NowMicros() - Start;
+
+            if (Config.Mode == "step" && Count != 1)
+                Fail("step reply did not carry exactly one record");
+            if (Config.Mode == "vec_step" && Count != size_t(NumEnvs))
+                Fail("vec_step reply did not carry one record per env");
+            if (Count == 0 || Count > size_t(Batch))
+                Fail("unexpected record count in reply");
+
+            if (i >= Config.Warmup)
+            {
+                Out.Steps += Count;
+                Out.BusyMicros += Micros;
+                Out.ReplyBytes += LastReplyBytes;
+                Out.Latency.Record(Micros);
+            }
+
+            // With auto-reset the server already started the next episode
+            bool bAnyDone = false;
+            for (size_t r = 0; r < Count; ++r)
+                bAnyDone |= Records[r].Done;
+            if (bAnyDone && !bAutoReset)
+                ResetFor(Config);
+        }
+    }
+
+private:
+    void ResetFor(const FRunConfig& Config)
+    {
+        Request = Config.Mode == "vec_step" ? "{\"cmd\":\"vec_reset\"}" : "{\"cmd\":\"reset\"}";
+        const size_t Count = RoundTripRecords();
+        if (Config.Mode == "vec_step")
+            NumEnvs = int(Count);
+        else if (Count != 1)
+            Fail("reset reply did not carry exactly one record");
+    }
+
+    void BuildStepRequest(const std::string& Mode, int Batch, int Index)
+    {
+        // Deterministic sweep so runs are comparable and the target actually gets hit now and then
+        auto AppendAction = [this](int i)
+        {
+            char Buf[64];
+            std::snprintf(Buf, sizeof(Buf), "[%.4f,%.4f,%d]",
+                0.5 * std::sin(i * 0.05), 0.8 * std::cos(i * 0.03), i % 30 == 0 ? 1 : 0);
+            Request += Buf;
+        };
+
+        if (Mode == "step")
+        {
+            Request = "{\"cmd\":\"step\",\"action\":";
+            AppendAction(Index);
+        }
+        else
+        {
+            Request = Mode == "vec_step" ? "{\"cmd\":\"vec_step\",\"actions\":[" : "{\"cmd\":\"step_n\",\"actions\":[";
+            for (int b = 0; b < Batch; ++b)
+            {
+                if (b) Request += ',';
+                AppendAction(Index * Batch + b);
+            }
+            Request += ']';
+        }
+        Request += '}';
+    }
+
+    void SendRequest()
+    {
+        if (!Loopback::SendText(Fd, Request, SendScratch))
+            Fail("send failed");
+    }
+
+    void RecvReply()
+    {
+        if (!Loopback::RecvFrame(Fd, Reply))
+            Fail("server closed the connection");
+        LastReplyBytes = Reply.size() + EnvWire::LengthPrefixSize;
+    }
+
+    Loopback::FJson RoundTripJson()
+    {
+        SendRequest();
+        RecvReply();
+        Loopback::FJson Out;
+        const char* Text = reinterpret_cast<const char*>(Reply.data());
+        if (!Loopback::FJsonParser(Text, Text + Reply.size()).Parse(Out))
+            Fail("reply is not valid JSON");
+        return Out;
+    }
+
+    /** Sends Request, decodes the reply into Records / Obs and returns the record count. */
+    size_t RoundTripRecords()
+    {
+        SendRequest();
+        RecvReply();
+        const size_t Count = EnvWire::IsBinaryFrame(Reply.data(), Reply.size()) ? DecodeBinary() : DecodeJson();
+        for (size_t i = 0; i < Count; ++i)
+        {
+            const float* O = &Obs[i * FMockEnv::ObsLen];
+            for (int s = 0; s < FMockEnv::NumScalarFeatures; ++s)
+            {
+                if (!std::isfinite(O[FMockEnv::GridLen + s]))
+                    Fail("non-finite scalar feature in observation");
+            }
+        }
+        return Count;
+    }
+
+    void EnsureRecords(size_t Count)
+    {
+        if (Records.size() < Count)
+            Records.resize(Count);
+        if (Obs.size() < Count * FMockEnv::ObsLen)
+            Obs.resize(Count * FMockEnv::ObsLen);
+    }
+
+    static void CopyRow(const Loopback::FJson& Row, float* Dst)
+    {
+        if (Row.Type != Loopback::FJson::EType::Array || Row.Array.size() != size_t(FMockEnv::ObsLen))
+            Fail("JSON observation has the wrong length");
+        for (size_t i = 0; i < Row.Array.size(); ++i)
+            Dst[i] = float(Row.Array[i].Number);
+    }
+
+    size_t DecodeJson()
+    {
+        Loopback::FJson Doc;
+        const char* Text = reinterpret_cast<const char*>(Reply.data());
+        if (!Loopback::FJsonParser(Text, Text + Reply.size()).Parse(Doc))
+            Fail("reply is not valid JSON");
+        if (Doc.GetString("status") == "error")
+            Fail("server answered with an error");
+
+        const Loopback::FJson* ObsField = Doc.Find("obs");
+        if (!ObsField)
+            Fail("JSON reply has no obs");
+
+        if (!Doc.Find("count"))
+        {
+            EnsureRecords(1);
+            CopyRow(*ObsField, Obs.data());
+            Records[0].Reward = float(Doc.GetNumber("reward", 0.0));
+            Records[0].Done = Doc.GetBool("done", false);
+            Records[0].DeltaTime = float(Doc.GetNumber("delta_time", 0.0));
+            return 1;
+        }
+
+        const size_t Count = size_t(Doc.GetNumber("count", 0.0));
+        const Loopback::FJson* Rewards = Doc.Find("reward");
+        const Loopback::FJson* Dones = Doc.Find("done");
+        const Loopback::FJson* DeltaTimes = Doc.Find("delta_time");
+        if (ObsField->Array.size() != Count || !Rewards || Rewards->Array.size() != Count ||
+            !Dones || Dones->Array.size() != Count || !DeltaTimes || DeltaTimes->Array.size() != Count)
+            Fail("JSON batch arrays disagree with count");
+
+        EnsureRecords(Count);
+        for (size_t i = 0; i < Count; ++i)
+        {
+            CopyRow(ObsField->Array[i], &Obs[i * FMockEnv::ObsLen]);
+            Records[i].Reward = float(Rewards->Array[i].Number);
+            Records[i].Done = Dones->Array[i].Bool;
+            Records[i].DeltaTime = float(DeltaTimes->Array[i].Number);
+        }
+        return Count;
+    }
+
+    size_t DecodeBinary()
+    {
+        EnvWire::FFrameHeader H;
+        std::memcpy(&H, Reply.data(), sizeof(H));
+        const std::vector<uint8_t>* Frame = &Reply;
+        if (H.Flags & EnvWire::FlagCompressed)
+        {
+            if (!Loopback::DecompressFrame(Reply.data(), Reply.size(), Inflated))
+                Fail("could not decompress frame");
+            Frame = &Inflated;
+        }
+
+        const uint8_t* P = Frame->data() + sizeof(H);
+        const uint8_t* End = Frame->data() + Frame->size();
+        if (H.Flags & EnvWire::FlagTimingBlock)
+            P += sizeof(EnvWire::FTimingBlock);
+
+        // One spare row past the records takes the reset observations
+        EnsureRecords(H.Count + 1);
+        const bool bResetRecords = (H.Flags & EnvWire::FlagAutoReset) != 0;
+        if (H.Kind == uint8_t(EnvWire::EFrameKind::SlotNotice))
+            return DecodeRing(P, End, H.Count, bResetRecords);
+
+        const bool bPackedRecord = (H.Flags & EnvWire::FlagPackedGrid) != 0;
+        const bool bEpisodeSummaries = (H.Flags & EnvWire::FlagEpisodeStats) != 0;
+        for (uint32_t i = 0; i < H.Count; ++i)
+        {
+            P = DecodeRecord(P, End, bPackedRecord, i);
+            if (bEpisodeSummaries && Records[i].Done)
+                P = DecodeEpisodeSummary(P, End);
+            if (bResetRecords && Records[i].Done)
+                P = DecodeResetRecord(P, End, bPackedRecord, H.Count);
+        }
+        if (P != End)
+            Fail("trailing bytes after the last record");
+        return H.Count;
+    }
+
+    const uint8_t* DecodeRecord(const uint8_t* P, const uint8_t* End, bool bPackedRecord, size_t Index)
+    {
+        EnvWire::FStepRecord R;
+        if (size_t(End - P) < sizeof(R))
+            Fail("truncated step record");
+        std::memcpy(&R, P, sizeof(R));
+        P += sizeof(R);
+        if (R.ObsLen != uint32_t(FMockEnv::ObsLen))
+            Fail("step record has the wrong observation length");
+
+        Records[Index].Reward = R.Reward;
+        Records[Index].Done = R.Done != 0;
+        Records[Index].DeltaTime = R.DeltaTime;
+        float* Dst = &Obs[Index * FMockEnv::ObsLen];
+
+        if (!bPackedRecord)
+        {
+            const size_t Bytes = size_t(R.ObsLen) * sizeof(float);
+            if (size_t(End - P) < Bytes)
+                Fail("truncated observation");
+            std::memcpy(Dst, P, Bytes);
+            return P + Bytes;
+        }
+
+        EnvWire::FPackedGrid G;
+        if (size_t(End - P) < sizeof(G))
+            Fail("truncated packed grid header");
+        std::memcpy(&G, P, sizeof(G));
+        P += sizeof(G);
+        if (G.GridLen > R.ObsLen)
+            Fail("packed grid longer than the observation");
+
+        std::memset(Dst, 0, size_t(G.GridLen) * sizeof(float));
+        if (G.Mode == uint8_t(EnvWire::EGridMode::Sparse))
+        {
+            if (size_t(End - P) < size_t(G.Count) * sizeof(uint16_t))
+                Fail("truncated sparse grid");
+            for (uint32_t k = 0; k < G.Count; ++k)
+            {
+                uint16_t Hit;
+                std::memcpy(&Hit, P, sizeof(Hit));
+                P += sizeof(Hit);
+                if (Hit >= G.GridLen)
+                    Fail("sparse grid index out of range");
+                Dst[Hit] = 1.0f;
+            }
+        }
+        else
+        {
+            const size_t Bytes = EnvWire::GridBitmapSize(G.GridLen);
+            if (size_t(End - P) < Bytes)
+                Fail("truncated grid bitmap");
+            for (uint32_t k = 0; k < G.GridLen; ++k)
+                Dst[k] = (P[k >> 3] >> (k & 7)) & 1u ? 1.0f : 0.0f;
+            P += Bytes;
+        }
+
+        const size_t ScalarBytes = size_t(R.ObsLen - G.GridLen) * sizeof(float);
+        if (size_t(End - P) < ScalarBytes)
+            Fail("truncated scalar tail");
+        std::memcpy(Dst + G.GridLen, P, ScalarBytes);
+        return P + ScalarBytes;
+    }
+
+    size_t DecodeRing(const uint8_t* P, const uint8_t* End, uint32_t Count, bool bResetRecords)
+    {
+        EnvShm::FSlotNotice N;
+        if (!RingBase || size_t(End - P) < sizeof(N))
+            Fail("slot notice without a mapped ring");
+        std::memcpy(&N, P, sizeof(N));
+
+        uint32_t Slot = N.FirstSlot;
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            const uint8_t* SlotData = RingBase + sizeof(EnvShm::FRingHeader) + size_t(Slot % RingSlots) * RingStride;
+            DecodeRecord(SlotData, SlotData + RingStride, false, i);
+            ++Slot;
+            if (bResetRecords && Records[i].Done)
+            {
+                // The reset record takes the next slot
+                SlotData = RingBase + sizeof(EnvShm::FRingHeader) + size_t(Slot % RingSlots) * RingStride;
+                DecodeResetRecord(SlotData, SlotData + RingStride, false, Count);
+                ++Slot;
+            }
+        }
+        return Count;
+    }
+
+    /** Decodes an auto-reset record into the spare row at Index; it must look like a reset reply. */
+    const uint8_t* DecodeResetRecord(const uint8_t* P, const uint8_t* End, bool bPackedRecord, size_t Index)
+    {
+        P = DecodeRecord(P, End, bPackedRecord, Index);
+        if (Records[Index].Done || Records[Index].Reward != 0.0f)
+            Fail("auto-reset record is not a fresh episode");
+        return P;
+    }
+
+    /** Checks the summary that follows a done record; a finished episode has steps and wasn't truncated. */
+    const uint8_t* DecodeEpisodeSummary(const uint8_t* P, const uint8_t* End)
+    {
+        EnvWire::FEpisodeSummary S;
+        if (size_t(End - P) < sizeof(S))
+            Fail("truncated episode summary");
+        std::memcpy(&S, P, sizeof(S));
+        if (S.Length == 0 || S.Truncated != 0 || S.Hits > S.ShotsFired)
+            Fail("episode summary does not describe a finished episode");
+        return P + sizeof(S);
+    }
+
+    void OpenRing(const std::string& Name)
+    {
+        const std::string Path = "/" + Name;
+        const int ShmFd = shm_open(Path.c_str(), O_RDONLY, 0);
+        struct stat St = {};
+        if (ShmFd < 0 || fstat(ShmFd, &St) != 0)
+            Fail("could not open the shared-memory ring");
+        RingSize = size_t(St.st_size);
+        void* View = mmap(nullptr, RingSize, PROT_READ, MAP_SHARED, ShmFd, 0);
+        close(ShmFd);
+        if (View == MAP_FAILED)
+            Fail("could not map the shared-memory ring");
+        RingBase = static_cast<uint8_t*>(View);
+
+        EnvShm::FRingHeader Header;
+        std::memcpy(&Header, RingBase, sizeof(Header));
+        if (Header.Magic != EnvShm::Magic || Header.Version != EnvShm::Version)
+            Fail("shared-memory ring has the wrong magic/version");
+        RingSlots = Header.SlotCount;
+        RingStride = Header.SlotStride;
+    }
+
+    EnvEndpoint::FEndpoint Endpoint;
+    int Fd = -1;
+    int NumEnvs = 1;
+    std::string NegotiatedEncoding = "json";
+    std::string NegotiatedCompression = "none";
+    bool bAutoReset = false;
+
+    std::string Request;
+    std::vector<uint8_t> SendScratch;
+    std::vector<uint8_t> Reply;
+    std::vector<uint8_t> Inflated;
+    size_t LastReplyBytes = 0;
+
+    std::vector<FDecoded> Records;
+    std::vector<float> Obs;
+
+    uint8_t* RingBase = nullptr;
+    size_t   RingSize = 0;
+    uint32_t RingSlots = 0;
+    uint32_t RingStride = 0;
+};
+
+namespace
+{
+    void PrintHeader()
+    {
+        std::printf("%-9s %-18s %6s %9s %12s %9s %9s %11s\n",
+            "mode", "encoding", "batch", "requests", "steps/s", "p50_us", "p99_us", "bytes/req");
+    }
+
+    void RunOne(const EnvEndpoint::FEndpoint& Endpoint, const FRunConfig& Config)
+    {
+        FLoopbackClient Client(Endpoint);
+        Client.Connect(Config);
+        FRunResult Result;
+        Client.Run(Config, Result);
+        Client.Disconnect();
+
+        std::string Label = Client.GetNegotiatedEncoding();
+        if (Config.ObsEncoding == "packed" && Label != "json")
+            Label += "+packed";
+        if (Client.GetNegotiatedCompression() == "zlib")
+            Label += "+zlib";
+        const double StepsPerSec = Result.BusyMicros ? double(Result.Steps) * 1e6 / double(Result.BusyMicros) : 0.0;
+        const uint64_t Requests = Result.Latency.GetCount();
+        std::printf("%-9s %-18s %6s %9llu %12.0f %9llu %9llu %11llu\n",
+            Config.Mode.c_str(), Label.c_str(),
+            Config.Mode == "vec_step" ? "K" : std::to_string(Config.Batch).c_str(),
+            (unsigned long long)Requests, StepsPerSec,
+            (unsigned long long)Result.Latency.GetPercentile(50.0),
+            (unsigned long long)Result.Latency.GetPercentile(99.0),
+            (unsigned long long)(Requests ? Result.ReplyBytes / Requests : 0));
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    EnvEndpoint::FEndpoint Endpoint;
+    bool bSweep = false;
+    FRunConfig Config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool bHasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--sweep")) bSweep = true;
+        else if (bHasValue && (!std::strcmp(argv[i], "--endpoint") || !std::strcmp(argv[i], "--port")))
+        {
+            if (!EnvEndpoint::Parse(argv[++i], Endpoint))
+                Fail("bad endpoint");
+        }
+        else if (bHasValue && !std::strcmp(argv[i], "--encoding")) Config.Encoding = argv[++i];
+        else if (bHasValue && !std::strcmp(argv[i], "--obs")) Config.ObsEncoding = argv[++i];
+        else if (bHasValue && !std::strcmp(argv[i], "--compression")) Config.Compression = argv[++i];
+        else if (bHasValue && !std::strcmp(argv[i], "--compress-threshold")) Config.CompressThreshold = std::atoi(argv[++i]);
+        else if (!std::strcmp(argv[i], "--auto-reset")) Config.bAutoReset = true;
+        else if (!std::strcmp(argv[i], "--episode-stats")) Config.bEpisodeStats = true;
+        else if (bHasValue && !std::strcmp(argv[i], "--action-repeat")) Config.ActionRepeat = std::atoi(argv[++i]);
+        else if (bHasValue && !std::strcmp(argv[i], "--mode")) Config.Mode = argv[++i];
+        else if (bHasValue && !std::strcmp(argv[i], "--batch")) Config.Batch = std::atoi(argv[++i]);
+        else if (bHasValue && !std::strcmp(argv[i], "--requests")) Config.Requests = std::atoi(argv[++i]);
+        else if (bHasValue && !std::strcmp(argv[i], "--warmup")) Config.Warmup = std::atoi(argv[++i]);
+        else
+        {
+            std::fprintf(stderr,
+                "usage: %s [--endpoint E | --port N] [--encoding json|binary|shm] [--obs float|packed]\n"
+                "          [--compression none|zlib] [--compress-threshold BYTES] [--auto-reset] [--episode-stats]\n"
+                "          [--action-repeat K]\n"
+                "          [--mode step|step_n|vec_step] [--batch N] [--requests N] [--warmup N] [--sweep]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (Config.Batch < 1 || Config.Requests < 1 || Config.Warmup < 0)
+        Fail("batch and requests must be positive");
+    if (Config.Mode != "step" && Config.Mode != "step_n" && Config.Mode != "vec_step")
+        Fail("unknown mode");
+
+    PrintHeader();
+    if (!bSweep)
+    {
+        if (Config.Mode == "step")
+            Config.Batch = 1;
+        RunOne(Endpoint, Config);
+        return 0;
+    }
+
+    // Every encoding against single steps, step_n trajectories and one vec_step batch
+    struct FEncodingCase { const char* Encoding; const char* Obs; const char* Compression; };
+    const FEncodingCase Encodings[] = {
+        { "json", "float", "none" }, { "binary", "float", "none" }, { "binary", "packed", "none" },
+        { "binary", "float", "zlib" }, { "binary", "packed", "zlib" }, { "shm", "float", "none" } };
+    const int TrajectoryBatches[] = { 8, 64 };
+
+    for (const FEncodingCase& E : Encodings)
+    {
+        FRunConfig Case = Config;
+        Case.Encoding = E.Encoding;
+        Case.ObsEncoding = E.Obs;
+        Case.Compression = E.Compression;
+
+        Case.Mode = "step";
+        Case.Batch = 1;
+        RunOne(Endpoint, Case);
+
+        for (int Batch : TrajectoryBatches)
+        {
+            Case.Mode = "step_n";
+            Case.Batch = Batch;
+            Case.Requests = Config.Requests / Batch > 0 ? Config.Requests / Batch : 1;
+            RunOne(Endpoint, Case);
+        }
+
+        Case.Mode = "vec_step";
+        Case.Requests = Config.Requests;
+        RunOne(Endpoint, Case);
+    }
+    return 0;
+}
@@ -0,0 +1,341 @@
+// LoopbackCommon.h
+#pragma once
+
+// Shared bits of the engine-free loopback harness: blocking POSIX socket helpers,
+// the monotonic clock, frame compression, and a small JSON reader/writer for the request side of the protocol.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "EnvWireFormat.h"
+
+namespace Loopback
+{
+    inline uint64_t NowMicros()
+    {
+        using namespace std::chrono;
+        return static_cast<uint64_t>(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    // ---------------------------------------------------------------- sockets
+
+    inline bool RecvAll(int Fd, void* Dst, size_t Len)
+    {
+        uint8_t* P = static_cast<uint8_t*>(Dst);
+        while (Len > 0)
+        {
+            const ssize_t N = recv(Fd, P, Len, 0);
+            if (N <= 0)
+                return false;
+            P += N;
+            Len -= size_t(N);
+        }
+        return true;
+    }
+
+    inline bool SendAll(int Fd, const void* Data, size_t Len)
+    {
+        const uint8_t* P = static_cast<const uint8_t*>(Data);
+        while (Len > 0)
+        {
+            const ssize_t N = send(Fd, P, Len, MSG_NOSIGNAL);
+            if (N <= 0)
+                return false;
+            P += N;
+            Len -= size_t(N);
+        }
+        return true;
+    }
+
+    /** Reads one length-prefixed payload into Buffer (reused between calls). */
+    inline bool RecvFrame(int Fd, std::vector<uint8_t>& Buffer)
+    {
+        uint32_t Len = 0;
+        if (!RecvAll(Fd, &Len, sizeof(Len)) || Len > EnvWire::MaxPayloadSize)
+            return false;
+        Buffer.resize(Len);
+        return Len == 0 || RecvAll(Fd, Buffer.data(), Len);
+    }
+
+    /** Sends Frame whose first LengthPrefixSize bytes are reserved for the prefix, in one write. */
+    inline bool SendFrame(int Fd, std::vector<uint8_t>& Frame)
+    {
+        EnvWire::WriteLengthPrefix(Frame.data(), static_cast<uint32_t>(Frame.size() - EnvWire::LengthPrefixSize));
+        return SendAll(Fd, Frame.data(), Frame.size());
+    }
+
+    /** Sends a text payload (JSON) behind the length prefix. */
+    inline bool SendText(int Fd, const std::string& Text, std::vector<uint8_t>& Scratch)
+    {
+        Scratch.resize(EnvWire::LengthPrefixSize + Text.size());
+        std::memcpy(Scratch.data() + EnvWire::LengthPrefixSize, Text.data(), Text.size());
+        return SendFrame(Fd, Scratch);
+    }
+
+    inline void SetNoDelay(int Fd)
+    {
+        int One = 1;
+        setsockopt(Fd, IPPROTO_TCP, TCP_NODELAY, &One, sizeof(One));
+    }
+
+    // ---------------------------------------------------------------- compression
+
+    /**
+     * Rewrites the frame in Frame (prefix reserved, header at the front) into Out with its body
+     * zlib-compressed, the way UTCPEnvSubsystem::CompressFrame does. False if it wouldn't shrink.
+     */
+    inline bool CompressFrame(const std::vector<uint8_t>& Frame, std::vector<uint8_t>& Out)
+    {
+        constexpr size_t Front = EnvWire::LengthPrefixSize + sizeof(EnvWire::FFrameHeader);
+        if (Frame.size() <= Front)
+            return false;
+        const size_t BodyLen = Frame.size() - Front;
+
+        uLongf CompressedLen = compressBound(uLong(BodyLen));
+        Out.resize(Front + sizeof(EnvWire::FCompressedBlock) + CompressedLen);
+        if (compress2(Out.data() + Front + sizeof(EnvWire::FCompressedBlock), &CompressedLen,
+                Frame.data() + Front, uLong(BodyLen), Z_BEST_SPEED) != Z_OK ||
+            sizeof(EnvWire::FCompressedBlock) + CompressedLen >= BodyLen)
+            return false;
+        Out.resize(Front + sizeof(EnvWire::FCompressedBlock) + CompressedLen);
+
+        EnvWire::FFrameHeader H;
+        std::memcpy(&H, Frame.data() + EnvWire::LengthPrefixSize, sizeof(H));
+        H.Flags |= EnvWire::FlagCompressed;
+        std::memcpy(Out.data() + EnvWire::LengthPrefixSize, &H, sizeof(H));
+
+        EnvWire::FCompressedBlock Block = {};
+        Block.RawSize = uint32_t(BodyLen);
+        Block.Codec = uint8_t(EnvWire::ECodec::Zlib);
+        std::memcpy(Out.data() + Front, &Block, sizeof(Block));
+        return true;
+    }
+
+    /**
+     * Turns a received compressed payload (no prefix) back into the plain frame in Out, header
+     * flag cleared. False on an unknown codec or a corrupt stream.
+     */
+    inline bool DecompressFrame(const uint8_t* Payload, size_t Len, std::vector<uint8_t>& Out)
+    {
+        constexpr size_t Front = sizeof(EnvWire::FFrameHeader) + sizeof(EnvWire::FCompressedBlock);
+        if (Len < Front)
+            return false;
+        EnvWire::FFrameHeader H;
+        EnvWire::FCompressedBlock Block;
+        std::memcpy(&H, Payload, sizeof(H));
+        std::memcpy(&Block, Payload + sizeof(H), sizeof(Block));
+        if (Block.Codec != uint8_t(EnvWire::ECodec::Zlib) || Block.RawSize > EnvWire::MaxPayloadSize)
+            return false;
+
+        Out.resize(sizeof(H) + Block.RawSize);
+        uLongf RawLen = Block.RawSize;
+        if (uncompress(Out.data() + sizeof(H), &RawLen, Payload + Front, uLong(Len - Front)) != Z_OK || RawLen != Block.RawSize)
+            return false;
+        H.Flags &= uint16_t(~EnvWire::FlagCompressed);
+        std::memcpy(Out.data(), &H, sizeof(H));
+        return true;
+    }
+
+    // ---------------------------------------------------------------- JSON
+
+    struct FJson
+    {
+        enum class EType : uint8_t { Null, Bool, Number, String, Array, Object };
+
+        EType Type = EType::Null;
+        bool Bool = false;
+        double Number = 0.0;
+        std::string String;
+        std::vector<FJson> Array;
+        std::vector<std::pair<std::string, FJson>> Object;
+
+        const FJson* Find(const char* Key) const
+        {
+            for (const auto& KV : Object)
+                if (KV.first == Key)
+                    return &KV.second;
+            return nullptr;
+        }
+
+        double GetNumber(const char* Key, double Default) const
+        {
+            const FJson* V = Find(Key);
+            return V && V->Type == EType::Number ? V->Number : Default;
+        }
+
+        bool GetBool(const char* Key, bool Default) const
+        {
+            const FJson* V = Find(Key);
+            return V && V->Type == EType::Bool ? V->Bool : Default;
+        }
+
+        std::string GetString(const char* Key) const
+        {
+            const FJson* V = Find(Key);
+            return V && V->Type == EType::String ? V->String : std::string();
+        }
+    };
+
+    /** Minimal recursive-descent parser; enough for the requests the trainer sends (no \u escapes). */
+    class FJsonParser
+    {
+    public:
+        FJsonParser(const char* InBegin, const char* InEnd) : P(InBegin), End(InEnd) {}
+
+        bool Parse(FJson& Out)
+        {
+            return Value(Out) && (SkipWs(), P == End);
+        }
+
+    private:
+        void SkipWs()
+        {
+            while (P < End && (*P == ' ' || *P == '\t' || *P == '\n' || *P == '\r'))
+                ++P;
+        }
+
+        bool Literal(const char* Text)
+        {
+            const size_t N = std::strlen(Text);
+            if (size_t(End - P) < N || std::memcmp(P, Text, N) != 0)
+                return false;
+            P += N;
+            return true;
+        }
+
+        bool Str(std::string& Out)
+        {
+            if (P >= End || *P != '"') return false;
+            ++P;
+            Out.clear();
+            while (P < End && *P != '"')
+            {
+                if (*P == '\\' && P + 1 < End)
+                {
+                    ++P;
+                    switch (*P)
+                    {
+                    case 'n': Out += '\n'; break;
+                    case 't': Out += '\t'; break;
+                    case 'r': Out += '\r'; break;
+                    default:  Out += *P; break;
+                    }
+                    ++P;
+                    continue;
+                }
+                Out += *P++;
+            }
+            if (P >= End) return false;
+            ++P;
+            return true;
+        }
+
+        bool Value(FJson& Out)
+        {
+            SkipWs();
+            if (P >= End) return false;
+            switch (*P)
+            {
+            case '{':
+            {
+                ++P;
+                Out.Type = FJson::EType::Object;
+                SkipWs();
+                if (P < End && *P == '}') { ++P; return true; }
+                while (true)
+                {
+                    SkipWs();
+                    std::pair<std::string, FJson> KV;
+                    if (!Str(KV.first)) return false;
+                    SkipWs();
+                    if (P >= End || *P++ != ':') return false;
+                    if (!Value(KV.second)) return false;
+                    Out.Object.push_back(std::move(KV));
+                    SkipWs();
+                    if (P < End && *P == ',') { ++P; continue; }
+                    if (P < End && *P == '}') { ++P; return true; }
+                    return false;
+                }
+            }
+            case '[':
+            {
+                ++P;
+                Out.Type = FJson::EType::Array;
+                SkipWs();
+                if (P < End && *P == ']') { ++P; return true; }
+                while (true)
+                {
+                    Out.Array.emplace_back();
+                    if (!Value(Out.Array.back())) return false;
+                    SkipWs();
+                    if (P < End && *P == ',') { ++P; continue; }
+                    if (P < End && *P == ']') { ++P; return true; }
+                    return false;
+                }
+            }
+            case '"':
+                Out.Type = FJson::EType::String;
+                return Str(Out.String);
+            case 't':
+                Out.Type = FJson::EType::Bool;
+                Out.Bool = true;
+                return Literal("true");
+            case 'f':
+                Out.Type = FJson::EType::Bool;
+                Out.Bool = false;
+                return Literal("false");
+            case 'n':
+                Out.Type = FJson::EType::Null;
+                return Literal("null");
+            default:
+            {
+                // strtod needs a terminated buffer; numbers are short, copy them out
+                char Buf[64];
+                size_t N = 0;
+                while (P + N < End && N < sizeof(Buf) - 1 && std::strchr("+-0123456789.eE", P[N]))
+                    ++N;
+                if (N == 0) return false;
+                std::memcpy(Buf, P, N);
+                Buf[N] = 0;
+                Out.Type = FJson::EType::Number;
+                Out.Number = std::strtod(Buf, nullptr);
+                P += N;
+                return true;
+            }
+            }
+        }
+
+        const char* P;
+        const char* End;
+    };
+
+    inline void AppendNumber(std::string& Out, double V)
+    {
+        char Buf[32];
+        const int N = std::snprintf(Buf, sizeof(Buf), "%.9g", V);
+        Out.append(Buf, size_t(N));
+    }
+
+    inline void AppendFloatArray(std::string& Out, const float* Values, size_t Count)
+    {
+        Out += '[';
+        for (size_t i = 0; i < Count; ++i)
+        {
+            if (i) Out += ',';
+            AppendNumber(Out, Values[i]);
+        }
+        Out += ']';
+    }
+}
@@ -0,0 +1,896 @@
+// LoopbackServer.cpp
+//
+// Engine-free stand-in for UTCPEnvSubsystem. Speaks the same length-prefixed JSON / binary / shm
+// protocol, but steps FMockEnv instances instead of a UWorld, so the transport can be benchmarked
+// and regression-tested without launching Unreal.
+//
+//   loopback_server [--endpoint tcp://127.0.0.1:7777 | --port 7777] [--envs 4] [--exec-us 0] [--tick-hz 60]
+//
+// --endpoint same syntax as the subsystem's Endpoint setting, e.g. unix:///tmp/steelrain.sock
+// --envs     number of instances vec_reset / vec_step drive (the "Env<K>" tag count in a level)
+// --exec-us  busy-waits this long per env step to stand in for game-thread cost
+// --tick-hz  engine tick rate simulated in stream mode
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <poll.h>
+
+#include "LoopbackCommon.h"
+#include "MockEnv.h"
+#include "EnvEndpoint.h"
+#include "EnvSharedMemory.h"
+#include "EnvTelemetry.h"
+#include "EnvWireFormat.h"
+
+namespace
+{
+    constexpr int MaxStepsPerRequest = 4096;
+
+    constexpr int NumPhases = int(EnvTelemetry::EPhase::Count);
+
+    enum class EEncoding { Json, Binary, SharedMemory };
+
+    struct FAction
+    {
+        float Pitch = 0.0f;
+        float Yaw = 0.0f;
+        int   Fire = 0;
+    };
+
+    FAction ParseAction(const Loopback::FJson* V)
+    {
+        FAction A;
+        if (V && V->Type == Loopback::FJson::EType::Array && V->Array.size() >= 3)
+        {
+            A.Pitch = float(V->Array[0].Number);
+            A.Yaw = float(V->Array[1].Number);
+            A.Fire = int(V->Array[2].Number);
+        }
+        return A;
+    }
+
+    uint32_t Elapsed(uint64_t From, uint64_t To)
+    {
+        return (From == 0 || To < From) ? 0u : uint32_t(To - From);
+    }
+
+    void BurnMicros(int Micros)
+    {
+        if (Micros <= 0)
+            return;
+        const uint64_t Until = Loopback::NowMicros() + uint64_t(Micros);
+        while (Loopback::NowMicros() < Until) {}
+    }
+}
+
+class FLoopbackServer
+{
+public:
+    FLoopbackServer(const EnvEndpoint::FEndpoint& InEndpoint, int InNumEnvs, int InExecUs, int InTickHz)
+        : Endpoint(InEndpoint), ExecUs(InExecUs), TickUs(uint64_t(1000000 / (InTickHz > 0 ? InTickHz : 60)))
+        , Histograms(EnvTelemetry::NumCommands * NumPhases)
+    {
+        for (int i = 0; i < InNumEnvs; ++i)
+            Envs.emplace_back(i);
+        Results.resize(size_t(InNumEnvs > MaxStepsPerRequest ? InNumEnvs : MaxStepsPerRequest));
+    }
+
+    int Run()
+    {
+        const bool bUnix = Endpoint.Kind == EnvEndpoint::EKind::Unix;
+        const int ListenFd = bUnix ? EnvEndpoint::ListenUnix(Endpoint.Path) : ListenTcp();
+        char Name[192];
+        EnvEndpoint::Format(Endpoint, Name, sizeof(Name));
+        if (ListenFd < 0)
+        {
+            std::fprintf(stderr, "loopback_server: failed to bind/listen on %s\n", Name);
+            return 1;
+        }
+        std::printf("loopback_server: listening on %s (%zu envs)\n", Name, Envs.size());
+        std::fflush(stdout);
+
+        // One client at a time, like the subsystem
+        while (true)
+        {
+            int ClientFd = -1;
+            if (bUnix)
+            {
+                // The Unix listener is non-blocking (the subsystem polls it), so wait for it here
+                pollfd P = { ListenFd, POLLIN, 0 };
+                if (poll(&P, 1, -1) > 0)
+                    ClientFd = EnvEndpoint::AcceptUnix(ListenFd);
+            }
+            else
+            {
+                ClientFd = accept(ListenFd, nullptr, nullptr);
+            }
+            if (ClientFd < 0)
+                continue;
+            if (!bUnix)
+                Loopback::SetNoDelay(ClientFd);
+            Serve(ClientFd);
+            close(ClientFd);
+
+            Encoding = EEncoding::Json;
+            bPackedGrid = false;
+            bTimingBlock = false;
+            bAutoReset = false;
+            ActionRepeat = 1;
+            for (FMockEnv& E : Envs)
+            {
+                E.SetAutoReset(false);
+                E.SetActionRepeat(1);
+            }
+            bEpisodeStats = false;
+            bCompress = false;
+            bStreaming = false;
+            // Like the engine, sync and dilation end with the connection
+            StepDt = 1.0f / 60.0f;
+            TimeDilation = 1.0f;
+            ApplyDeltaTime();
+            ShmRing.Close();
+        }
+    }
+
+private:
+    int ListenTcp() const
+    {
+        sockaddr_in Addr = {};
+        Addr.sin_family = AF_INET;
+        Addr.sin_port = htons(Endpoint.Port);
+        if (inet_pton(AF_INET, Endpoint.Host, &Addr.sin_addr) != 1)
+            return -1;
+
+        const int Fd = socket(AF_INET, SOCK_STREAM, 0);
+        int One = 1;
+        setsockopt(Fd, SOL_SOCKET, SO_REUSEADDR, &One, sizeof(One));
+        if (bind(Fd, reinterpret_cast<sockaddr*>(&Addr), sizeof(Addr)) != 0 || listen(Fd, 1) != 0)
+        {
+            close(Fd);
+            return -1;
+        }
+        return Fd;
+    }
+
+    struct FRequestTiming
+    {
+        uint64_t RecvStart = 0;
+        uint64_t Parsed = 0;
+        uint64_t ExecStart = 0;
+        uint64_t ExecEnd = 0;
+        uint64_t EncodeStart = 0;
+        uint64_t SendStart = 0;
+        uint64_t SendEnd = 0;
+    };
+
+    bool ReceiveRequest(int Fd, Loopback::FJson& Out)
+    {
+        uint32_t Len = 0;
+        if (!Loopback::RecvAll(Fd, &Len, sizeof(Len)))
+            return false;
+
+        Timing = FRequestTiming();
+        Timing.RecvStart = Loopback::NowMicros();
+        if (Len > EnvWire::MaxPayloadSize)
+            return false;
+
+        RecvBuffer.resize(Len);
+        if (Len > 0 && !Loopback::RecvAll(Fd, RecvBuffer.data(), Len))
+            return false;
+
+        const char* Text = reinterpret_cast<const char*>(RecvBuffer.data());
+        Out = Loopback::FJson();
+        return Loopback::FJsonParser(Text, Text + Len).Parse(Out);
+    }
+
+    /** In stream mode, runs engine ticks until a request is readable. False if the client went away. */
+    bool WaitForRequest(int Fd)
+    {
+        while (bStreaming)
+        {
+            const uint64_t Now = Loopback::NowMicros();
+            if (Now >= NextTickUs)
+            {
+                StreamTick(Fd);
+                NextTickUs = (NextTickUs + TickUs > Now) ? NextTickUs + TickUs : Now + TickUs;
+                continue;
+            }
+            pollfd P = { Fd, POLLIN, 0 };
+            const int Ready = poll(&P, 1, int((NextTickUs - Now + 999) / 1000));
+            if (Ready < 0)
+                return false;
+            if (Ready > 0)
+                return true;
+        }
+        return true;
+    }
+
+    void StreamTick(int Fd)
+    {
+        // The mock has no separate world tick, so the newest action is applied and observed in one go
+        EnvWire::FStreamInfo Info = {};
+        Info.Tick = ++StreamTickId;
+        Info.ActionTick = PendingStreamTick;
+        Info.Superseded = SupersededActions;
+        Info.SkippedFrames = SkippedStreamFrames;
+
+        const FAction A = PendingStreamTick != 0 ? PendingStreamAction : FAction();
+        Envs[0].StepOneTick(A.Pitch, A.Yaw, A.Fire, Results[0]);
+        PendingStreamTick = 0;
+        SupersededActions = 0;
+
+        const FMockStep& SR = Results[0];
+        StreamBuffer.resize(EnvWire::LengthPrefixSize + sizeof(EnvWire::FFrameHeader) + sizeof(Info) + RecordMaxSize(SR));
+        const uint16_t Flags = (bPackedGrid ? EnvWire::FlagPackedGrid : 0) | (bAutoReset ? EnvWire::FlagAutoReset : 0) |
+            (bEpisodeStats ? EnvWire::FlagEpisodeStats : 0);
+        uint8_t* Cursor = EnvWire::WriteFrameHeader(StreamBuffer.data() + EnvWire::LengthPrefixSize,
+            EnvWire::EFrameKind::Stream, Flags, 1);
+        std::memcpy(Cursor, &Info, sizeof(Info));
+        Cursor = WriteRecord(Cursor + sizeof(Info), SR);
+        StreamBuffer.resize(size_t(Cursor - StreamBuffer.data()));
+
+        // Same rule as the subsystem: skip the frame rather than block on a client that isn't reading
+        pollfd P = { Fd, POLLOUT, 0 };
+        const bool bWritable = poll(&P, 1, 0) > 0 && (P.revents & POLLOUT);
+        SkippedStreamFrames = (bWritable && Loopback::SendFrame(Fd, StreamBuffer)) ? 0 : SkippedStreamFrames + 1;
+    }
+
+    void Serve(int Fd)
+    {
+        Loopback::FJson Req;
+        while (WaitForRequest(Fd) && ReceiveRequest(Fd, Req))
+        {
+            Timing.Parsed = Loopback::NowMicros();
+            const std::string Cmd = Req.GetString("cmd");
+            std::string Resp;
+            bool bReplied = false;
+            bool bOk = true;
+
+            if (Cmd == "hello")
+            {
+                const std::string Requested = Req.GetString("encoding");
+                Encoding = (Requested == "binary" || Requested == "shm") ? EEncoding::Binary : EEncoding::Json;
+
+                std::string ShmFields;
+                if (Requested == "shm")
+                {
+                    const double Slots = Req.GetNumber("slots", EnvShm::DefaultSlotCount);
+                    const double ObsCapacity = Req.GetNumber("obs_capacity", EnvShm::DefaultObsCapacity);
+                    // Same naming as the subsystem: per port for TCP, per process for a socket path
+                    const std::string ShmName = Endpoint.Kind == EnvEndpoint::EKind::Unix
+                        ? "steelrain_env_p" + std::to_string(getpid())
+                        : "steelrain_env_" + std::to_string(Endpoint.Port);
+                    if (ShmRing.Create(ShmName.c_str(), uint32_t(Slots > 0 ? Slots : 0), uint32_t(ObsCapacity > 0 ? ObsCapacity : 0)))
+                    {
+                        Encoding = EEncoding::SharedMemory;
+                        ShmFields = ",\"shm_name\":\"" + ShmName + "\",\"slots\":" + std::to_string(ShmRing.GetSlotCount()) +
+                            ",\"obs_capacity\":" + std::to_string(ShmRing.GetObsCapacity());
+                    }
+                    else
+                    {
+                        std::fprintf(stderr, "loopback_server: could not map shared memory '%s', using binary frames\n", ShmName.c_str());
+                    }
+                }
+
+                bPackedGrid = Encoding != EEncoding::Json && Req.GetString("obs_encoding") == "packed";
+                bTimingBlock = Req.GetBool("timing", false);
+                bAutoReset = Req.GetBool("auto_reset", false);
+                const double Repeat = Req.GetNumber("action_repeat", 1.0);
+                ActionRepeat = Repeat < 1.0 ? 1 : (Repeat > 1000.0 ? 1000 : int(Repeat));
+                for (FMockEnv& E : Envs)
+                {
+                    E.SetAutoReset(bAutoReset);
+                    E.SetActionRepeat(ActionRepeat);
+                }
+                bEpisodeStats = Encoding != EEncoding::SharedMemory && Req.GetBool("episode_stats", false);
+                bCompress = Encoding != EEncoding::Json && Req.GetString("compression") == "zlib";
+                const double Threshold = Req.GetNumber("compress_threshold", EnvWire::DefaultCompressThreshold);
+                CompressThreshold = Threshold > 0 ? size_t(Threshold) : 0;
+
+                Resp = std::string("{\"status\":\"ok\",\"encoding\":\"") +
+                    (Encoding == EEncoding::SharedMemory ? "shm" : Encoding == EEncoding::Binary ? "binary" : "json") +
+                    "\",\"version\":" + std::to_string(EnvWire::Version) +
+                    ",\"obs_encoding\":\"" + (bPackedGrid ? "packed" : "float") + "\"" +
+                    ",\"timing\":" + (bTimingBlock ? "true" : "false") +
+                    ",\"auto_reset\":" + (bAutoReset ? "true" : "false") +
+                    ",\"action_repeat\":" + std::to_string(ActionRepeat) +
+                    ",\"episode_stats\":" + (bEpisodeStats ? "true" : "false") +
+                    ",\"compression\":\"" + (bCompress ? "zlib" : "none") + "\"" +
+                    ",\"compress_threshold\":" + std::to_string(CompressThreshold) + ShmFields;
+            }
+            else if ((Cmd == "reset" || Cmd == "step" || Cmd == "step_n" || Cmd == "snapshot" || Cmd == "restore") &&
+                     !FindEnv(Req))
+            {
+                Resp = "{\"status\":\"error\",\"env\":" + std::to_string(int64_t(Req.GetNumber("env", 0))) +
+                    ",\"num_envs\":" + std::to_string(Envs.size());
+            }
+            else if (Cmd == "reset" || Cmd == "step")
+            {
+                // Optional "env": k drives that instance instead of instance 0
+                FMockEnv& E = *FindEnv(Req);
+                BeginExecute();
+                if (Cmd == "reset")
+                {
+                    E.Reset(Results[0]);
+                }
+                else
+                {
+                    const FAction A = ParseAction(Req.Find("action"));
+                    E.Step(A.Pitch, A.Yaw, A.Fire, Results[0]);
+                }
+                BurnMicros(ExecUs);
+                EndExecute();
+                bOk = SendResults(Fd, 1, EnvWire::EFrameKind::Step);
+                bReplied = true;
+            }
+            else if (Cmd == "step_n")
+            {
+                // Either "actions": [[p,y,f], ...] or "action": [p,y,f] plus "repeat": N
+                Actions.clear();
+                const Loopback::FJson* ActionList = Req.Find("actions");
+                if (ActionList && ActionList->Type == Loopback::FJson::EType::Array)
+                {
+                    for (const Loopback::FJson& V : ActionList->Array)
+                        Actions.push_back(ParseAction(&V));
+                }
+                else
+                {
+                    const int Repeat = int(Req.GetNumber("repeat", 1));
+                    Actions.assign(size_t(Repeat < 1 ? 1 : (Repeat > MaxStepsPerRequest ? MaxStepsPerRequest : Repeat)), ParseAction(Req.Find("action")));
+                }
+                if (Actions.size() > size_t(MaxStepsPerRequest))
+                    Actions.resize(MaxStepsPerRequest);
+
+                // Stops early on done like the game thread does, unless auto-reset carries on into the next episode
+                FMockEnv& E = *FindEnv(Req);
+                BeginExecute();
+                size_t Count = 0;
+                for (const FAction& A : Actions)
+                {
+                    E.Step(A.Pitch, A.Yaw, A.Fire, Results[Count]);
+                    BurnMicros(ExecUs);
+                    if (Results[Count++].Done && !bAutoReset)
+                        break;
+                }
+                EndExecute();
+                bOk = SendResults(Fd, Count, EnvWire::EFrameKind::Trajectory);
+                bReplied = true;
+            }
+            else if (Cmd == "vec_reset" || Cmd == "vec_step")
+            {
+                const bool bStep = (Cmd == "vec_step");
+                Actions.clear();
+                const Loopback::FJson* ActionList = Req.Find("actions");
+                if (bStep && ActionList && ActionList->Type == Loopback::FJson::EType::Array)
+                {
+                    for (const Loopback::FJson& V : ActionList->Array)
+                        Actions.push_back(ParseAction(&V));
+                }
+
+                if (bStep && Actions.size() != Envs.size())
+                {
+                    std::fprintf(stderr, "loopback_server: vec_step got %zu actions for %zu envs\n", Actions.size(), Envs.size());
+                    Resp = "{\"status\":\"error\",\"num_envs\":" + std::to_string(Envs.size());
+                }
+                else
+                {
+                    BeginExecute();
+                    for (size_t i = 0; i < Envs.size(); ++i)
+                    {
+                        if (bStep)
+                            Envs[i].Step(Actions[i].Pitch, Actions[i].Yaw, Actions[i].Fire, Results[i]);
+                        else
+                            Envs[i].Reset(Results[i]);
+                        BurnMicros(ExecUs);
+                    }
+                    EndExecute();
+                    bOk = SendResults(Fd, Envs.size(), EnvWire::EFrameKind::Batch);
+                    bReplied = true;
+                }
+            }
+            else if (Cmd == "sync")
+            {
+                // Only the fixed step matters here: it becomes the delta_time every record reports
+                const bool bEnable = Req.GetBool("enabled", true);
+                double FixedDt = Req.GetNumber("fixed_dt", 1.0 / 60.0);
+                FixedDt = FixedDt < 1e-4 ? 1e-4 : (FixedDt > 1.0 ? 1.0 : FixedDt);
+                int TicksPerStep = int(Req.GetNumber("ticks_per_step", 1));
+                TicksPerStep = TicksPerStep < 1 ? 1 : (TicksPerStep > MaxStepsPerRequest ? MaxStepsPerRequest : TicksPerStep);
+                StepDt = bEnable ? float(FixedDt * TicksPerStep) : 1.0f / 60.0f;
+                ApplyDeltaTime();
+
+                Resp = std::string("{\"status\":\"ok\",\"sync\":") + (bEnable ? "true" : "false") + ",\"fixed_dt\":";
+                Loopback::AppendNumber(Resp, float(FixedDt));
+                Resp += ",\"ticks_per_step\":" + std::to_string(TicksPerStep);
+            }
+            else if (Cmd == "snapshot" || Cmd == "restore")
+            {
+                // snapshot: {"slot": k, "seed": s, "env": i, "on_reset": bool}, restore: {"slot": k, "env": i}
+                FMockEnv& E = *FindEnv(Req);
+                const int Slot = int(Req.GetNumber("slot", 0));
+                if (Cmd == "snapshot" && Slot >= 0)
+                {
+                    // The mock is deterministic, the seed is only echoed
+                    const int Actors = E.CaptureSnapshot(Slot);
+                    if (Req.GetBool("on_reset", false))
+                        E.SetResetSnapshot(Slot);
+                    Resp = "{\"status\":\"ok\",\"slot\":" + std::to_string(Slot) + ",\"actors\":" + std::to_string(Actors) +
+                        ",\"seed\":" + std::to_string(int64_t(Req.GetNumber("seed", 0)));
+                }
+                else if (Cmd == "restore" && Slot >= 0 && E.RestoreSnapshot(Slot, Results[0]))
+                {
+                    bOk = SendResults(Fd, 1, EnvWire::EFrameKind::Step);
+                    bReplied = true;
+                }
+                else
+                {
+                    Resp = "{\"status\":\"error\",\"slot\":" + std::to_string(Slot);
+                }
+            }
+            else if (Cmd == "set_time_dilation")
+            {
+                // Clamped like the default AWorldSettings Min/MaxGlobalTimeDilation
+                double Dilation = Req.GetNumber("dilation", 1.0);
+                Dilation = Dilation < 1e-4 ? 1e-4 : (Dilation > 20.0 ? 20.0 : Dilation);
+                TimeDilation = float(Dilation);
+                ApplyDeltaTime();
+
+                Resp = "{\"status\":\"ok\",\"time_dilation\":";
+                Loopback::AppendNumber(Resp, TimeDilation);
+            }
+            else if (Cmd == "episode_stats")
+            {
+                BeginExecute();
+                EpisodeScratch.clear();
+                uint64_t Dropped = 0;
+                for (FMockEnv& E : Envs)
+                    Dropped += E.DrainEpisodeStats(EpisodeScratch);
+                EndExecute();
+
+                Resp = "{\"status\":\"ok\",\"episodes\":[";
+                for (size_t i = 0; i < EpisodeScratch.size(); ++i)
+                {
+                    if (i) Resp += ',';
+                    AppendEpisode(Resp, EpisodeScratch[i]);
+                }
+                Resp += "],\"dropped\":" + std::to_string(Dropped);
+            }
+            else if (Cmd == "stats")
+            {
+                Resp = "{\"status\":\"ok\",\"stats\":";
+                AppendStats(Resp);
+                if (Req.GetBool("reset", false))
+                {
+                    for (EnvTelemetry::FLatencyHistogram& H : Histograms)
+                        H.Reset();
+                }
+            }
+            else if (Cmd == "stream")
+            {
+                bStreaming = Req.GetBool("enabled", true);
+                StreamTickId = 0;
+                PendingStreamTick = 0;
+                SupersededActions = 0;
+                SkippedStreamFrames = 0;
+                NextTickUs = Loopback::NowMicros() + TickUs;
+                Resp = std::string("{\"status\":\"ok\",\"stream\":") + (bStreaming ? "true" : "false");
+            }
+            else if (Cmd == "act")
+            {
+                // No reply; the next stream tick picks up the newest action
+                if (PendingStreamTick != 0)
+                    ++SupersededActions;
+                PendingStreamAction = ParseAction(Req.Find("action"));
+                const double ActionTick = Req.GetNumber("tick", 1.0);
+                PendingStreamTick = ActionTick >= 1.0 ? uint64_t(ActionTick) : 1;
+                continue;
+            }
+            else if (Cmd == "pause" || Cmd == "resume")
+            {
+                Resp = std::string("{\"status\":\"") + (Cmd == "pause" ? "paused" : "resumed") + "\"";
+            }
+            else
+            {
+                Resp = "{";
+            }
+
+            if (!bReplied)
+                bOk = SendJson(Fd, Resp);
+            if (!bOk)
+                break;
+            RecordRequestTiming(Cmd);
+        }
+    }
+
+    void BeginExecute() { Timing.ExecStart = Loopback::NowMicros(); }
+    void EndExecute() { Timing.ExecEnd = Loopback::NowMicros(); }
+
+    uint16_t FrameFlags() const
+    {
+        return (bPackedGrid ? EnvWire::FlagPackedGrid : 0) | (bTimingBlock ? EnvWire::FlagTimingBlock : 0) |
+            (bAutoReset ? EnvWire::FlagAutoReset : 0) | (bEpisodeStats ? EnvWire::FlagEpisodeStats : 0);
+    }
+
+    size_t RecordMaxSize(const FMockStep& SR) const
+    {
+        const uint32_t ObsLen = uint32_t(SR.Obs.size());
+        size_t Size = bPackedGrid ? EnvWire::PackedStepRecordMaxSize(ObsLen, GridLength(ObsLen)) : EnvWire::StepRecordSize(ObsLen);
+        if (bEpisodeStats && SR.Done)
+            Size += sizeof(EnvWire::FEpisodeSummary);
+        if (bAutoReset && SR.Done)
+        {
+            const uint32_t ResetLen = uint32_t(SR.ResetObs.size());
+            Size += bPackedGrid ? EnvWire::PackedStepRecordMaxSize(ResetLen, GridLength(ResetLen)) : EnvWire::StepRecordSize(ResetLen);
+        }
+        return Size;
+    }
+
+    uint8_t* WriteRecord(uint8_t* Cursor, const FMockStep& SR) const
+    {
+        const uint32_t ObsLen = uint32_t(SR.Obs.size());
+        Cursor = bPackedGrid
+            ? EnvWire::WritePackedStepRecord(Cursor, SR.Reward, SR.Done, SR.DeltaTime, SR.Obs.data(), ObsLen, GridLength(ObsLen))
+            : EnvWire::WriteStepRecord(Cursor, SR.Reward, SR.Done, SR.DeltaTime, SR.Obs.data(), ObsLen);
+        if (bEpisodeStats && SR.Done)
+        {
+            std::memcpy(Cursor, &SR.Episode, sizeof(SR.Episode));
+            Cursor += sizeof(SR.Episode);
+        }
+        if (bAutoReset && SR.Done)
+        {
+            const uint32_t ResetLen = uint32_t(SR.ResetObs.size());
+            Cursor = bPackedGrid
+                ? EnvWire::WritePackedStepRecord(Cursor, 0.0f, false, 0.0f, SR.ResetObs.data(), ResetLen, GridLength(ResetLen))
+                : EnvWire::WriteStepRecord(Cursor, 0.0f, false, 0.0f, SR.ResetObs.data(), ResetLen);
+        }
+        return Cursor;
+    }
+
+    EnvWire::FTimingBlock MakeTimingBlock() const
+    {
+        // No game-thread hop here, so queue and wake stay zero
+        EnvWire::FTimingBlock T = {};
+        T.RecvUs = Elapsed(Timing.RecvStart, Timing.Parsed);
+        T.ExecuteUs = Elapsed(Timing.ExecStart, Timing.ExecEnd);
+        T.PrevEncodeUs = LastEncodeUs;
+        T.PrevSendUs = LastSendUs;
+        return T;
+    }
+
+    /** Resp is an unterminated JSON object; closes it after the optional timing field and sends. */
+    bool SendJson(int Fd, std::string& Resp)
+    {
+        if (Timing.EncodeStart == 0)
+            Timing.EncodeStart = Loopback::NowMicros();
+
+        if (bTimingBlock)
+        {
+            const EnvWire::FTimingBlock T = MakeTimingBlock();
+            char Buf[192];
+            std::snprintf(Buf, sizeof(Buf),
+                "%s\"timing\":{\"recv_us\":%u,\"queue_us\":%u,\"execute_us\":%u,\"wake_us\":%u,\"prev_encode_us\":%u,\"prev_send_us\":%u}",
+                Resp.size() > 1 ? "," : "", T.RecvUs, T.QueueUs, T.ExecuteUs, T.WakeUs, T.PrevEncodeUs, T.PrevSendUs);
+            Resp += Buf;
+        }
+        Resp += '}';
+
+        FrameBuffer.resize(EnvWire::LengthPrefixSize + Resp.size());
+        std::memcpy(FrameBuffer.data() + EnvWire::LengthPrefixSize, Resp.data(), Resp.size());
+        return SendFrame(Fd);
+    }
+
+    bool SendResults(int Fd, size_t Count, EnvWire::EFrameKind Kind)
+    {
+        Timing.EncodeStart = Loopback::NowMicros();
+
+        if (Encoding == EEncoding::Json)
+        {
+            // step/reset reply with a flat object, step_n / vec_* with parallel arrays
+            std::string& Resp = JsonScratch;
+            Resp.clear();
+            if (Kind == EnvWire::EFrameKind::Step)
+            {
+                const FMockStep& SR = Results[0];
+                Resp += "{\"obs\":";
+                Loopback::AppendFloatArray(Resp, SR.Obs.data(), SR.Obs.size());
+                Resp += ",\"reward\":";
+                Loopback::AppendNumber(Resp, SR.Reward);
+                Resp += SR.Done ? ",\"done\":true" : ",\"done\":false";
+                Resp += ",\"delta_time\":";
+                Loopback::AppendNumber(Resp, SR.DeltaTime);
+                if (bAutoReset && SR.Done)
+                {
+                    Resp += ",\"reset_obs\":";
+                    Loopback::AppendFloatArray(Resp, SR.ResetObs.data(), SR.ResetObs.size());
+                }
+                if (bEpisodeStats && SR.Done)
+                {
+                    Resp += ",\"episode\":";
+                    AppendEpisode(Resp, SR.Episode);
+                }
+            }
+            else
+            {
+                Resp += "{\"count\":" + std::to_string(Count) + ",\"obs\":[";
+                for (size_t i = 0; i < Count; ++i)
+                {
+                    if (i) Resp += ',';
+                    Loopback::AppendFloatArray(Resp, Results[i].Obs.data(), Results[i].Obs.size());
+                }
+                Resp += "],\"reward\":[";
+                for (size_t i = 0; i < Count; ++i)
+                {
+                    if (i) Resp += ',';
+                    Loopback::AppendNumber(Resp, Results[i].Reward);
+                }
+                Resp += "],\"done\":[";
+                for (size_t i = 0; i < Count; ++i)
+                    Resp += i ? (Results[i].Done ? ",true" : ",false") : (Results[i].Done ? "true" : "false");
+                Resp += "],\"delta_time\":[";
+                for (size_t i = 0; i < Count; ++i)
+                {
+                    if (i) Resp += ',';
+                    Loopback::AppendNumber(Resp, Results[i].DeltaTime);
+                }
+                Resp += ']';
+                if (bAutoReset)
+                {
+                    Resp += ",\"reset_obs\":[";
+                    for (size_t i = 0; i < Count; ++i)
+                    {
+                        if (i) Resp += ',';
+                        const FMockStep& SR = Results[i];
+                        Loopback::AppendFloatArray(Resp, SR.ResetObs.data(), SR.Done ? SR.ResetObs.size() : 0);
+                    }
+                    Resp += ']';
+                }
+                if (bEpisodeStats)
+                {
+                    Resp += ",\"episodes\":[";
+                    for (size_t i = 0; i < Count; ++i)
+                    {
+                        if (i) Resp += ',';
+                        if (Results[i].Done)
+                            AppendEpisode(Resp, Results[i].Episode);
+                        else
+                            Resp += "null";
+                    }
+                    Resp += ']';
+                }
+            }
+            return SendJson(Fd, Resp);
+        }
+
+        if (Encoding == EEncoding::SharedMemory && FitsRing(Count))
+        {
+            uint32_t FirstSlot = 0;
+            for (size_t i = 0; i < Count; ++i)
+            {
+                const FMockStep& SR = Results[i];
+                const uint32_t Slot = ShmRing.WriteRecord(SR.Reward, SR.Done, SR.DeltaTime, SR.Obs.data(), uint32_t(SR.Obs.size()));
+                if (i == 0)
+                    FirstSlot = Slot;
+                if (bAutoReset && SR.Done)
+                    ShmRing.WriteRecord(0.0f, false, 0.0f, SR.ResetObs.data(), uint32_t(SR.ResetObs.size()));
+            }
+            FrameBuffer.resize(EnvWire::LengthPrefixSize + sizeof(EnvWire::FFrameHeader) + sizeof(EnvShm::FSlotNotice));
+            EnvShm::WriteSlotNotice(FrameBuffer.data() + EnvWire::LengthPrefixSize, FirstSlot, uint32_t(Count), Kind,
+                bAutoReset ? EnvWire::FlagAutoReset : 0);
+            return SendFrame(Fd);
+        }
+
+        size_t Size = sizeof(EnvWire::FFrameHeader) + sizeof(EnvWire::FTimingBlock);
+        for (size_t i = 0; i < Count; ++i)
+            Size += RecordMaxSize(Results[i]);
+        FrameBuffer.resize(EnvWire::LengthPrefixSize + Size);
+
+        uint8_t* Payload = FrameBuffer.data() + EnvWire::LengthPrefixSize;
+        uint8_t* Cursor = EnvWire::WriteFrameHeader(Payload, Kind, FrameFlags(), uint32_t(Count));
+        if (bTimingBlock)
+        {
+            const EnvWire::FTimingBlock T = MakeTimingBlock();
+            std::memcpy(Cursor, &T, sizeof(T));
+            Cursor += sizeof(T);
+        }
+        for (size_t i = 0; i < Count; ++i)
+            Cursor = WriteRecord(Cursor, Results[i]);
+        FrameBuffer.resize(size_t(Cursor - FrameBuffer.data()));
+
+        // Only batches are worth compressing, single steps stay well under any sane threshold
+        const size_t BodyLen = size_t(Cursor - Payload) - sizeof(EnvWire::FFrameHeader);
+        if (bCompress && Kind != EnvWire::EFrameKind::Step && BodyLen >= CompressThreshold &&
+            Loopback::CompressFrame(FrameBuffer, CompressBuffer))
+            FrameBuffer.swap(CompressBuffer);
+        return SendFrame(Fd);
+    }
+
+    bool FitsRing(size_t Count) const
+    {
+        if (!ShmRing.IsOpen() || Count == 0)
+            return false;
+        size_t Slots = 0;
+        for (size_t i = 0; i < Count; ++i)
+        {
+            const bool bResetRecord = bAutoReset && Results[i].Done;
+            if (Results[i].Obs.size() > ShmRing.GetObsCapacity() ||
+                (bResetRecord && Results[i].ResetObs.size() > ShmRing.GetObsCapacity()))
+                return false;
+            Slots += bResetRecord ? 2 : 1;
+        }
+        return Slots <= ShmRing.GetSlotCount();
+    }
+
+    static uint32_t GridLength(uint32_t ObsLen)
+    {
+        return ObsLen > uint32_t(FMockEnv::NumScalarFeatures) ? ObsLen - FMockEnv::NumScalarFeatures : 0;
+    }
+
+    bool SendFrame(int Fd)
+    {
+        Timing.SendStart = Loopback::NowMicros();
+        const bool bSent = Loopback::SendFrame(Fd, FrameBuffer);
+        Timing.SendEnd = Loopback::NowMicros();
+        return bSent;
+    }
+
+    void RecordRequestTiming(const std::string& Cmd)
+    {
+        const int CmdIndex = EnvTelemetry::CommandIndex(Cmd.c_str());
+
+        LastEncodeUs = Elapsed(Timing.EncodeStart, Timing.SendStart);
+        LastSendUs = Elapsed(Timing.SendStart, Timing.SendEnd);
+
+        if (Timing.SendEnd == 0)
+            return;
+
+        using EnvTelemetry::EPhase;
+        EnvTelemetry::FLatencyHistogram* H = &Histograms[size_t(CmdIndex * NumPhases)];
+        H[int(EPhase::Recv)].Record(Elapsed(Timing.RecvStart, Timing.Parsed));
+        if (Timing.ExecStart != 0)
+            H[int(EPhase::Execute)].Record(Elapsed(Timing.ExecStart, Timing.ExecEnd));
+        H[int(EPhase::Encode)].Record(LastEncodeUs);
+        H[int(EPhase::Send)].Record(LastSendUs);
+        H[int(EPhase::Total)].Record(Elapsed(Timing.RecvStart, Timing.SendEnd));
+    }
+
+    void AppendStats(std::string& Out) const
+    {
+        Out += '{';
+        bool bFirstCmd = true;
+        for (int c = 0; c < EnvTelemetry::NumCommands; ++c)
+        {
+            bool bFirstPhase = true;
+            for (int p = 0; p < NumPhases; ++p)
+            {
+                const EnvTelemetry::FLatencyHistogram& H = Histograms[size_t(c * NumPhases + p)];
+                if (H.GetCount() == 0)
+                    continue;
+
+                if (bFirstPhase)
+                {
+                    Out += bFirstCmd ? "\"" : ",\"";
+                    Out += EnvTelemetry::Commands[c];
+                    Out += "\":{";
+                    bFirstCmd = false;
+                }
+                char Buf[256];
+                std::snprintf(Buf, sizeof(Buf),
+                    "%s\"%s\":{\"count\":%llu,\"mean_us\":%.3f,\"min_us\":%llu,\"p50_us\":%llu,\"p90_us\":%llu,\"p99_us\":%llu,\"p999_us\":%llu,\"max_us\":%llu}",
+                    bFirstPhase ? "" : ",", EnvTelemetry::PhaseName(static_cast<EnvTelemetry::EPhase>(p)),
+                    (unsigned long long)H.GetCount(), H.GetMean(), (unsigned long long)H.GetMin(),
+                    (unsigned long long)H.GetPercentile(50.0), (unsigned long long)H.GetPercentile(90.0),
+                    (unsigned long long)H.GetPercentile(99.0), (unsigned long long)H.GetPercentile(99.9),
+                    (unsigned long long)H.GetMax());
+                Out += Buf;
+                bFirstPhase = false;
+            }
+            if (!bFirstPhase)
+                Out += '}';
+        }
+        Out += '}';
+    }
+
+    static void AppendEpisode(std::string& Out, const EnvWire::FEpisodeSummary& S)
+    {
+        Out += "{\"env\":" + std::to_string(S.EnvIndex) + ",\"return\":";
+        Loopback::AppendNumber(Out, S.Return);
+        Out += ",\"length\":" + std::to_string(S.Length) + ",\"hits\":" + std::to_string(S.Hits) +
+            ",\"shots\":" + std::to_string(S.ShotsFired) + ",\"fire_blocked\":" + std::to_string(S.FireBlocked) +
+            ",\"time_to_first_hit\":";
+        Loopback::AppendNumber(Out, S.TimeToFirstHit);
+        Out += ",\"duration\":";
+        Loopback::AppendNumber(Out, S.Duration);
+        Out += S.Truncated ? ",\"truncated\":true}" : ",\"truncated\":false}";
+    }
+
+    /** Instance named by the request's optional "env" field, nullptr if there is no such instance. */
+    FMockEnv* FindEnv(const Loopback::FJson& Req)
+    {
+        const double Index = Req.GetNumber("env", 0);
+        return (Index >= 0 && Index < double(Envs.size())) ? &Envs[size_t(Index)] : nullptr;
+    }
+
+    /** Every record's delta_time is the step's simulated length: base step scaled by the dilation. */
+    void ApplyDeltaTime()
+    {
+        for (FMockEnv& E : Envs)
+            E.SetDeltaTime(StepDt * TimeDilation);
+    }
+
+    EnvEndpoint::FEndpoint Endpoint;
+    int ExecUs;
+    uint64_t TickUs;
+    std::vector<FMockEnv> Envs;
+    std::vector<FMockStep> Results;
+    std::vector<FAction> Actions;
+    std::vector<EnvWire::FEpisodeSummary> EpisodeScratch;
+
+    EEncoding Encoding = EEncoding::Json;
+    bool bPackedGrid = false;
+    bool bTimingBlock = false;
+    bool bAutoReset = false;
+    int ActionRepeat = 1;
+    bool bEpisodeStats = false;
+    bool bCompress = false;
+    size_t CompressThreshold = EnvWire::DefaultCompressThreshold;
+    EnvShm::FRing ShmRing;
+
+    float StepDt = 1.0f / 60.0f;
+    float TimeDilation = 1.0f;
+
+    bool bStreaming = false;
+    uint64_t NextTickUs = 0;
+    uint64_t StreamTickId = 0;
+    uint64_t PendingStreamTick = 0;
+    FAction PendingStreamAction;
+    uint32_t SupersededActions = 0;
+    uint32_t SkippedStreamFrames = 0;
+    std::vector<uint8_t> StreamBuffer;
+
+    FRequestTiming Timing;
+    uint32_t LastEncodeUs = 0;
+    uint32_t LastSendUs = 0;
+    std::vector<EnvTelemetry::FLatencyHistogram> Histograms;
+
+    std::vector<uint8_t> RecvBuffer;
+    std::vector<uint8_t> FrameBuffer;
+    std::vector<uint8_t> CompressBuffer;
+    std::string JsonScratch;
+};
+
+int main(int argc, char** argv)
+{
+    EnvEndpoint::FEndpoint Endpoint;
+    int NumEnvs = 4;
+    int ExecUs = 0;
+    int TickHz = 60;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!std::strcmp(argv[i], "--endpoint") || !std::strcmp(argv[i], "--port"))
+        {
+            if (!EnvEndpoint::Parse(argv[i + 1], Endpoint))
+            {
+                std::fprintf(stderr, "loopback_server: bad endpoint '%s'\n", argv[i + 1]);
+                return 2;
+            }
+        }
+        else if (!std::strcmp(argv[i], "--envs")) NumEnvs = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--exec-us")) ExecUs = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--tick-hz")) TickHz = std::atoi(argv[i + 1]);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--endpoint E | --port N] [--envs K] [--exec-us N] [--tick-hz N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (NumEnvs < 1)
+        NumEnvs = 1;
+
+    FLoopbackServer Server(Endpoint, NumEnvs, ExecUs, TickHz);
+    return Server.Run();
+}
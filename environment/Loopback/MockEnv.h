@@ -0,0 +1,288 @@
+// MockEnv.h
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "EnvEpisodeStats.h"
+
+/**
+ * Deterministic stand-in for UUE5Game with the same observation layout as AObservationManager:
+ * a 27x41 peripheral 0/1 grid followed by NormPitch, NormYaw, NormDist, SignedNormAngle, Overlap.
+ *
+ * The target drifts through the turret's pitch/yaw window on a Lissajous path whose phase comes
+ * from the env index, so every run (and every instance) replays the same episode for the same actions.
+ * Reward and done follow the real managers closely enough to exercise the trainer's code paths;
+ * none of the numbers mean anything physically.
+ */
+struct FMockStep
+{
+    std::vector<float> Obs;
+    float Reward = 0.0f;
+    bool  Done = false;
+    float DeltaTime = 0.0f;
+    std::vector<float> ResetObs;  // next episode's first observation when auto-reset ended this one
+    EnvWire::FEpisodeSummary Episode = {};  // filled in when Done is set
+};
+
+class FMockEnv
+{
+public:
+    static constexpr int   PeriphRows = 27;
+    static constexpr int   PeriphCols = 41;
+    static constexpr int   GridLen = PeriphRows * PeriphCols;
+    static constexpr int   NumScalarFeatures = 5;
+    static constexpr int   ObsLen = GridLen + NumScalarFeatures;
+
+    // Same clamp window as UUE5Game
+    static constexpr float MinPitch = 4.0f;
+    static constexpr float MaxPitch = 21.0f;
+    static constexpr float MinYaw = 253.0f;
+    static constexpr float MaxYaw = 278.0f;
+
+    // Angular extent of the peripheral grid around the aim point, in degrees
+    static constexpr float GridHalfPitch = 13.0f;
+    static constexpr float GridHalfYaw = 20.0f;
+    static constexpr float TargetRadius = 1.5f;
+    static constexpr float HitRadius = 1.0f;
+
+    static constexpr float PenaltyPerSecond = 0.1f;
+    static constexpr float MaxShapingReward = 0.01f;
+    static constexpr float HitReward = 10.0f;
+    static constexpr float PerShotPenalty = 0.1f;
+    static constexpr int   MaxEpisodeSteps = 600;
+
+    explicit FMockEnv(int InEnvIndex = 0) : EnvIndex(InEnvIndex) {}
+
+    int GetEnvIndex() const { return EnvIndex; }
+
+    void SetDeltaTime(float InDeltaTime) { DeltaTime = InDeltaTime; }
+
+    /** Same contract as UUE5Game::SetAutoReset: a terminal Step resets and fills Out.ResetObs. */
+    void SetAutoReset(bool bEnable) { bAutoReset = bEnable; }
+
+    /** Same contract as UUE5Game::SetActionRepeat: Step runs this many ticks of the same action. */
+    void SetActionRepeat(int Repeat) { ActionRepeat = Repeat > 1 ? Repeat : 1; }
+
+    /** Same contract as UUE5Game::CaptureSnapshot; the mock's whole world is the aim, the clock and the step count. */
+    int CaptureSnapshot(int Slot)
+    {
+        FSnapshot& S = Snapshots[Slot];
+        S.Pitch = Pitch;
+        S.Yaw = Yaw;
+        S.SimTime = SimTime;
+        S.StepCount = StepCount;
+        return 1;  // the target
+    }
+
+    /** Resets straight into Slot's state; false if the slot is empty. */
+    bool RestoreSnapshot(int Slot, FMockStep& Out)
+    {
+        auto It = Snapshots.find(Slot);
+        if (It == Snapshots.end())
+            return false;
+        Reset(Out, &It->second);
+        return true;
+    }
+
+    /** Slot every Reset (auto-resets included) restores, -1 for the default spawn state. */
+    void SetResetSnapshot(int Slot) { ResetSnapshotSlot = Slot; }
+
+    void Reset(FMockStep& Out)
+    {
+        Reset(Out, FindResetSnapshot());
+    }
+
+    /** Same contract as UUE5Game::DrainEpisodeStats. */
+    uint64_t DrainEpisodeStats(std::vector<EnvWire::FEpisodeSummary>& Out)
+    {
+        return EpisodeSummaries.Drain([&Out](const EnvWire::FEpisodeSummary& S) { Out.push_back(S); });
+    }
+
+    void Step(float PitchDelta, float YawDelta, int FireFlag, FMockStep& Out)
+    {
+        StepTicks(PitchDelta, YawDelta, FireFlag, ActionRepeat, Out);
+    }
+
+    /** A single tick whatever the action repeat, like the engine's stream mode. */
+    void StepOneTick(float PitchDelta, float YawDelta, int FireFlag, FMockStep& Out)
+    {
+        StepTicks(PitchDelta, YawDelta, FireFlag, 1, Out);
+    }
+
+private:
+    void StepTicks(float PitchDelta, float YawDelta, int FireFlag, int MaxTicks, FMockStep& Out)
+    {
+        // Action repeat: the same action tick after tick, rewards summed, until done or MaxTicks
+        float Reward = 0.0f;
+        bool bDone = false;
+        int Ticks = 0;
+        do
+        {
+            bDone = Tick(PitchDelta, YawDelta, FireFlag, Reward);
+        } while (++Ticks < MaxTicks && !bDone);
+
+        BuildObservation(Out.Obs);
+        Out.Reward = Reward;
+        Out.Done = bDone;
+        Out.DeltaTime = DeltaTime * float(Ticks);
+
+        Episode.Return += Reward;
+        ++Episode.Length;
+        if (Out.Done)
+            Out.Episode = FinishEpisode(false);
+
+        if (Out.Done && bAutoReset)
+        {
+            ResetState(FindResetSnapshot());
+            BuildObservation(Out.ResetObs);
+        }
+        else
+        {
+            Out.ResetObs.clear();
+        }
+    }
+
+    struct FSnapshot
+    {
+        float  Pitch = 0.0f;
+        float  Yaw = 0.0f;
+        double SimTime = 0.0;
+        int    StepCount = 0;
+    };
+
+    /** One engine tick with the action applied; adds its reward and returns whether the episode ended. */
+    bool Tick(float PitchDelta, float YawDelta, int FireFlag, float& Reward)
+    {
+        Pitch = Clamp(Pitch + PitchDelta, MinPitch, MaxPitch);
+        Yaw = Clamp(Yaw + YawDelta, MinYaw, MaxYaw);
+        ++StepCount;
+        SimTime += DeltaTime;
+        UpdateTarget();
+
+        const float Dist = AngularDistance();
+        Reward += -PenaltyPerSecond * DeltaTime + MaxShapingReward * NormDist(Dist) * NormDist(Dist);
+        bool bHit = false;
+        if (FireFlag != 0)
+        {
+            Reward -= PerShotPenalty;
+            ++Episode.ShotsFired;
+            if (Dist <= HitRadius)
+            {
+                Reward += HitReward;
+                Episode.AddHit(SimTime);
+                bHit = true;
+            }
+        }
+        return bHit || StepCount >= MaxEpisodeSteps;
+    }
+
+    const FSnapshot* FindResetSnapshot() const
+    {
+        auto It = Snapshots.find(ResetSnapshotSlot);
+        return It != Snapshots.end() ? &It->second : nullptr;
+    }
+
+    void Reset(FMockStep& Out, const FSnapshot* Snapshot)
+    {
+        if (Episode.Length > 0)
+            FinishEpisode(true);
+        ResetState(Snapshot);
+        BuildObservation(Out.Obs);
+        Out.Reward = 0.0f;
+        Out.Done = false;
+        Out.DeltaTime = 0.0f;
+        Out.ResetObs.clear();
+    }
+
+    void ResetState(const FSnapshot* Snapshot)
+    {
+        Pitch = Snapshot ? Snapshot->Pitch : 0.5f * (MinPitch + MaxPitch);
+        Yaw = Snapshot ? Snapshot->Yaw : 0.5f * (MinYaw + MaxYaw);
+        StepCount = Snapshot ? Snapshot->StepCount : 0;
+        SimTime = Snapshot ? Snapshot->SimTime : 0.0;
+        UpdateTarget();
+        Episode.Begin(SimTime);
+    }
+
+    EnvWire::FEpisodeSummary FinishEpisode(bool bTruncated)
+    {
+        const EnvWire::FEpisodeSummary Summary = Episode.Finish(SimTime, EnvIndex, bTruncated);
+        EpisodeSummaries.Push(Summary);
+        Episode.Begin(SimTime);
+        return Summary;
+    }
+
+    static float Clamp(float V, float Lo, float Hi)
+    {
+        return V < Lo ? Lo : (V > Hi ? Hi : V);
+    }
+
+    float NormDist(float Dist) const
+    {
+        const float MaxDist = std::sqrt(GridHalfPitch * GridHalfPitch + GridHalfYaw * GridHalfYaw);
+        return Clamp(1.0f - Dist / MaxDist, 0.0f, 1.0f);
+    }
+
+    float AngularDistance() const
+    {
+        const float DP = TargetPitch - Pitch;
+        const float DY = TargetYaw - Yaw;
+        return std::sqrt(DP * DP + DY * DY);
+    }
+
+    void UpdateTarget()
+    {
+        const double Phase = 0.61803398875 * EnvIndex;
+        const double T = SimTime + Phase * 10.0;
+        TargetPitch = float(0.5 * (MinPitch + MaxPitch) + 0.45 * (MaxPitch - MinPitch) * std::sin(0.7 * T + Phase));
+        TargetYaw = float(0.5 * (MinYaw + MaxYaw) + 0.45 * (MaxYaw - MinYaw) * std::sin(0.5 * T));
+    }
+
+    void BuildObservation(std::vector<float>& Obs) const
+    {
+        Obs.assign(ObsLen, 0.0f);
+
+        // Row 0 is the top of the view, column 0 the left edge, like the sensor sweep
+        const float CellPitch = 2.0f * GridHalfPitch / float(PeriphRows - 1);
+        const float CellYaw = 2.0f * GridHalfYaw / float(PeriphCols - 1);
+        for (int r = 0; r < PeriphRows; ++r)
+        {
+            const float RayPitch = Pitch + GridHalfPitch - r * CellPitch;
+            for (int c = 0; c < PeriphCols; ++c)
+            {
+                const float RayYaw = Yaw - GridHalfYaw + c * CellYaw;
+                const float DP = TargetPitch - RayPitch;
+                const float DY = TargetYaw - RayYaw;
+                if (DP * DP + DY * DY <= TargetRadius * TargetRadius)
+                    Obs[r * PeriphCols + c] = 1.0f;
+            }
+        }
+
+        const float Dist = AngularDistance();
+        const float Angle = std::atan2(TargetPitch - Pitch, TargetYaw - Yaw) / 3.14159265f;
+        float* Scalars = Obs.data() + GridLen;
+        Scalars[0] = Clamp((Pitch - MinPitch) / (MaxPitch - MinPitch), 0.0f, 1.0f);
+        Scalars[1] = Clamp((Yaw - MinYaw) / (MaxYaw - MinYaw), 0.0f, 1.0f);
+        Scalars[2] = NormDist(Dist);
+        Scalars[3] = Angle;
+        Scalars[4] = Dist <= HitRadius ? 1.0f : 0.0f;
+    }
+
+    int    EnvIndex = 0;
+    float  Pitch = 0.0f;
+    float  Yaw = 0.0f;
+    float  TargetPitch = 0.0f;
+    float  TargetYaw = 0.0f;
+    float  DeltaTime = 1.0f / 60.0f;
+    double SimTime = 0.0;
+    int    StepCount = 0;
+    bool   bAutoReset = false;
+    int    ActionRepeat = 1;
+    std::map<int, FSnapshot> Snapshots;
+    int    ResetSnapshotSlot = -1;
+    EnvEpisodeStats::FCounters    Episode;
+    EnvEpisodeStats::FSummaryRing EpisodeSummaries;
+};
@@ -0,0 +1,180 @@
+// RasterBench.cpp
+//
+// Off-engine check and benchmark of the peripheral rasterizer (PeripheralRaster.h). Places random
+// target boxes around a randomly oriented pyramid with the sensor's default geometry, compares
+// Rasterize against testing every cell's ray, and prints ns per grid for both. Any cell the
+// projected rectangle wrongly culls is reported and fails the run. --foveated F runs the same
+// check on the foveated layout that traces about F of the grid's rays.
+//
+//   raster_bench [--cases N] [--seed S] [--rows 27] [--angle 8] [--range 15000] [--foveated 0.33]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "LoopbackCommon.h"
+#include "PeripheralRaster.h"
+
+namespace
+{
+    using PeripheralRaster::FBox;
+    using PeripheralRaster::FPyramid;
+    using PeripheralRaster::FVec3;
+
+    FVec3 Normalize(FVec3 V)
+    {
+        const double Len = std::sqrt(V.X * V.X + V.Y * V.Y + V.Z * V.Z);
+        return { V.X / Len, V.Y / Len, V.Z / Len };
+    }
+
+    FVec3 Cross(const FVec3& A, const FVec3& B)
+    {
+        return { A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X };
+    }
+
+    // Pyramid at a random spot and heading, geometry as APeripheralPyramid's defaults
+    FPyramid RandomPyramid(std::mt19937& Rng, int Rows, double AngleDeg, double Range)
+    {
+        std::uniform_real_distribution<double> Pos(-5000.0, 5000.0);
+        std::normal_distribution<double> Gauss;
+
+        FPyramid P;
+        P.Origin = { Pos(Rng), Pos(Rng), Pos(Rng) };
+        P.Forward = Normalize({ Gauss(Rng), Gauss(Rng), Gauss(Rng) });
+        const FVec3 WorldUp = std::fabs(P.Forward.Z) < 0.99 ? FVec3{ 0.0, 0.0, 1.0 } : FVec3{ 1.0, 0.0, 0.0 };
+        P.Right = Normalize(Cross(WorldUp, P.Forward));
+        P.Up = Cross(P.Forward, P.Right);
+        P.Height = Rows;
+        P.Width = int32_t(std::lround(Rows * 1.5));
+        P.VertScale = std::tan(AngleDeg * 3.14159265358979323846 / 180.0);
+        P.HorzScale = 1.5 * P.VertScale;
+        P.MaxRange = Range;
+        return P;
+    }
+
+    // Target-sized box somewhere along the view, usually inside the pyramid, sometimes behind or out of range
+    FBox RandomBox(std::mt19937& Rng, const FPyramid& P)
+    {
+        std::uniform_real_distribution<double> Depth(-0.1 * P.MaxRange, 1.2 * P.MaxRange);
+        std::uniform_real_distribution<double> Side(-1.3, 1.3);
+        std::uniform_real_distribution<double> Size(20.0, 800.0);
+
+        const double F = Depth(Rng);
+        const double R = Side(Rng) * P.HorzScale * std::fabs(F);
+        const double U = Side(Rng) * P.VertScale * std::fabs(F);
+        const FVec3 C = {
+            P.Origin.X + P.Forward.X * F + P.Right.X * R + P.Up.X * U,
+            P.Origin.Y + P.Forward.Y * F + P.Right.Y * R + P.Up.Y * U,
+            P.Origin.Z + P.Forward.Z * F + P.Right.Z * R + P.Up.Z * U,
+        };
+        const FVec3 E = { Size(Rng), Size(Rng), Size(Rng) };
+        return { { C.X - E.X, C.Y - E.Y, C.Z - E.Z }, { C.X + E.X, C.Y + E.Y, C.Z + E.Z } };
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int Cases = 20000;
+    unsigned Seed = 1;
+    int Rows = 27;
+    double Angle = 8.0;
+    double Range = 15000.0;
+    double Foveated = 0.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool bHasValue = i + 1 < argc;
+        if (bHasValue && !std::strcmp(argv[i], "--cases")) Cases = std::atoi(argv[++i]);
+        else if (bHasValue && !std::strcmp(argv[i], "--seed")) Seed = unsigned(std::strtoul(argv[++i], nullptr, 10));
+        else if (bHasValue && !std::strcmp(argv[i], "--rows")) Rows = std::atoi(argv[++i]);
+        else if (bHasValue && !std::strcmp(argv[i], "--angle")) Angle = std::atof(argv[++i]);
+        else if (bHasValue && !std::strcmp(argv[i], "--range")) Range = std::atof(argv[++i]);
+        else if (bHasValue && !std::strcmp(argv[i], "--foveated")) Foveated = std::atof(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--cases N] [--seed S] [--rows N] [--angle DEG] [--range UU] [--foveated FRACTION]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (Cases < 1 || Rows < 2 || Foveated < 0.0 || Foveated > 1.0)
+    {
+        std::fprintf(stderr, "cases must be positive, rows at least 2 and the foveated fraction within [0, 1]\n");
+        return 2;
+    }
+
+    // Foveated layout, same per-axis split as APeripheralPyramid
+    const int OutW = int(std::lround(Rows * 1.5));
+    const int TracedW = Foveated > 0.0 ? PeripheralRaster::FoveatedCellCount(OutW, Foveated) : OutW;
+    const int TracedH = Foveated > 0.0 ? PeripheralRaster::FoveatedCellCount(Rows, Foveated) : Rows;
+    std::vector<double> ColumnNorms(TracedW), RowNorms(TracedH);
+    PeripheralRaster::FoveatedNorms(OutW, TracedW, ColumnNorms.data());
+    PeripheralRaster::FoveatedNorms(Rows, TracedH, RowNorms.data());
+    for (double& N : RowNorms)
+        N = -N;
+
+    std::mt19937 Rng(Seed);
+    std::vector<FPyramid> Pyramids;
+    std::vector<FBox> Boxes;
+    Pyramids.reserve(Cases);
+    Boxes.reserve(Cases);
+    for (int c = 0; c < Cases; ++c)
+    {
+        Pyramids.push_back(RandomPyramid(Rng, Rows, Angle, Range));
+        if (Foveated > 0.0)
+        {
+            Pyramids.back().Width = TracedW;
+            Pyramids.back().Height = TracedH;
+            Pyramids.back().ColumnNorms = ColumnNorms.data();
+            Pyramids.back().RowNorms = RowNorms.data();
+        }
+        Boxes.push_back(RandomBox(Rng, Pyramids.back()));
+    }
+
+    const int W = Pyramids[0].Width;
+    const int H = Pyramids[0].Height;
+    std::vector<uint8_t> Raster(size_t(W) * H);
+    std::vector<uint8_t> Reference(size_t(W) * H);
+
+    // Correctness: the projected rectangle must never cull a cell the full scan finds
+    uint64_t Mismatches = 0;
+    uint64_t CoveredCells = 0;
+    int NonEmpty = 0;
+    for (int c = 0; c < Cases; ++c)
+    {
+        const int32_t N = PeripheralRaster::Rasterize(Pyramids[c], Boxes[c], Raster.data());
+        for (int j = 0; j < H; ++j)
+            for (int i = 0; i < W; ++i)
+                Reference[j * W + i] = PeripheralRaster::CellHitsBox(Pyramids[c], Boxes[c], i, j, 1.0) ? 1 : 0;
+        if (std::memcmp(Raster.data(), Reference.data(), Raster.size()) != 0)
+        {
+            if (++Mismatches <= 5)
+                std::fprintf(stderr, "case %d: rasterizer disagrees with the full scan\n", c);
+        }
+        CoveredCells += uint64_t(N);
+        NonEmpty += N > 0;
+    }
+
+    // Timing: rasterizer vs one ray-box test per cell, over the same cases
+    volatile int32_t Sink = 0;
+    uint64_t T0 = Loopback::NowMicros();
+    for (int c = 0; c < Cases; ++c)
+        Sink = Sink + PeripheralRaster::Rasterize(Pyramids[c], Boxes[c], Raster.data());
+    const uint64_t RasterMicros = Loopback::NowMicros() - T0;
+
+    T0 = Loopback::NowMicros();
+    for (int c = 0; c < Cases; ++c)
+        for (int j = 0; j < H; ++j)
+            for (int i = 0; i < W; ++i)
+                Sink = Sink + PeripheralRaster::CellHitsBox(Pyramids[c], Boxes[c], i, j, 1.0);
+    const uint64_t ScanMicros = Loopback::NowMicros() - T0;
+
+    std::printf("grid %dx%d  cases %d  in view %d  avg covered %.1f cells\n",
+        H, W, Cases, NonEmpty, NonEmpty ? double(CoveredCells) / NonEmpty : 0.0);
+    std::printf("rasterize  %8.0f ns/grid\n", 1000.0 * RasterMicros / Cases);
+    std::printf("full scan  %8.0f ns/grid\n", 1000.0 * ScanMicros / Cases);
+    std::printf("mismatches %llu\n", static_cast<unsigned long long>(Mismatches));
+    return Mismatches == 0 ? 0 : 1;
+}
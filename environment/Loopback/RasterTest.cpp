@@ -0,0 +1,308 @@
+// RasterTest.cpp
+//
+// Correctness test of the peripheral rasterizer (PeripheralRaster.h) against references that don't
+// share its ray-box kernel. RasterBench only checks Rasterize against CellHitsBox, so it catches wrong
+// culling but not a wrong hit test; this checks the covered cells themselves:
+//
+//   - closed-form cases: an axis-aligned pyramid and walls whose edges sit halfway between two cells'
+//     rays, so the covered columns and rows are known exactly, plus boxes behind, beyond range,
+//     around the origin and out of view;
+//   - a sampled ray march: every cell's ray, built here from the documented formula, is stepped through
+//     random boxes. A cell must be covered if the march hits the box shrunk by the step, and must not
+//     be if it misses the box grown by the step.
+//
+// Both run on the even and the foveated layout. Exits non-zero on any failure.
+//
+//   raster_test [--cases N] [--seed S]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "PeripheralRaster.h"
+
+namespace
+{
+    using PeripheralRaster::FBox;
+    using PeripheralRaster::FPyramid;
+    using PeripheralRaster::FVec3;
+
+    constexpr double Pi = 3.14159265358979323846;
+    constexpr int Rows = 27;
+    constexpr double AngleDeg = 8.0;
+    constexpr double Range = 15000.0;
+    constexpr double Step = 5.0;   // ray march step and the tolerance it implies
+
+    int Failures = 0;
+
+    void Fail(const char* Case, const char* Detail, int I, int J)
+    {
+        if (++Failures <= 20)
+            std::fprintf(stderr, "%s: %s at cell (row %d, col %d)\n", Case, Detail, J, I);
+    }
+
+    double Dot(const FVec3& A, const FVec3& B)
+    {
+        return A.X * B.X + A.Y * B.Y + A.Z * B.Z;
+    }
+
+    FVec3 Normalize(FVec3 V)
+    {
+        const double Len = std::sqrt(Dot(V, V));
+        return { V.X / Len, V.Y / Len, V.Z / Len };
+    }
+
+    FVec3 Cross(const FVec3& A, const FVec3& B)
+    {
+        return { A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X };
+    }
+
+    // Grid layout along both axes: evenly spaced NormX / NormY, or the foveated tables
+    struct FLayout
+    {
+        int W = 0;
+        int H = 0;
+        std::vector<double> ColumnNorms;   // ascending
+        std::vector<double> RowNorms;      // descending, row 0 at the top
+        bool bFoveated = false;
+
+        FLayout(double Foveated)
+            : bFoveated(Foveated > 0.0)
+        {
+            const int OutW = int(std::lround(Rows * 1.5));
+            W = bFoveated ? PeripheralRaster::FoveatedCellCount(OutW, Foveated) : OutW;
+            H = bFoveated ? PeripheralRaster::FoveatedCellCount(Rows, Foveated) : Rows;
+            ColumnNorms.resize(W);
+            RowNorms.resize(H);
+            if (bFoveated)
+            {
+                PeripheralRaster::FoveatedNorms(OutW, W, ColumnNorms.data());
+                PeripheralRaster::FoveatedNorms(Rows, H, RowNorms.data());
+                for (double& N : RowNorms)
+                    N = -N;
+            }
+            else
+            {
+                // -1..1 left to right, 1..-1 top to bottom, as documented in PeripheralRaster.h
+                for (int i = 0; i < W; ++i)
+                    ColumnNorms[i] = (i - (W - 1) * 0.5) / ((W - 1) * 0.5);
+                for (int j = 0; j < H; ++j)
+                    RowNorms[j] = -(j - (H - 1) * 0.5) / ((H - 1) * 0.5);
+            }
+        }
+
+        FPyramid Pyramid(const FVec3& Origin, const FVec3& Forward, const FVec3& Right, const FVec3& Up) const
+        {
+            FPyramid P;
+            P.Origin = Origin;
+            P.Forward = Forward;
+            P.Right = Right;
+            P.Up = Up;
+            P.Width = W;
+            P.Height = H;
+            P.VertScale = std::tan(AngleDeg * Pi / 180.0);
+            P.HorzScale = 1.5 * P.VertScale;
+            P.MaxRange = Range;
+            if (bFoveated)
+            {
+                P.ColumnNorms = ColumnNorms.data();
+                P.RowNorms = RowNorms.data();
+            }
+            return P;
+        }
+    };
+
+    // Cell (i, j)'s ray from the header's formula, without going through the kernel
+    FVec3 ReferenceRay(const FPyramid& P, const FLayout& L, int I, int J)
+    {
+        const double SX = L.ColumnNorms[I] * P.HorzScale;
+        const double SY = L.RowNorms[J] * P.VertScale;
+        return Normalize({
+            P.Forward.X + P.Right.X * SX + P.Up.X * SY,
+            P.Forward.Y + P.Right.Y * SX + P.Up.Y * SY,
+            P.Forward.Z + P.Right.Z * SX + P.Up.Z * SY,
+        });
+    }
+
+    bool Inside(const FVec3& Q, const FBox& B)
+    {
+        return Q.X >= B.Min.X && Q.X <= B.Max.X && Q.Y >= B.Min.Y && Q.Y <= B.Max.Y && Q.Z >= B.Min.Z && Q.Z <= B.Max.Z;
+    }
+
+    FBox Grow(const FBox& B, double D)
+    {
+        return { { B.Min.X - D, B.Min.Y - D, B.Min.Z - D }, { B.Max.X + D, B.Max.Y + D, B.Max.Z + D } };
+    }
+
+    // Samples [0, MaxRange] every Step, restricted to the stretch that can reach the box's bounding sphere
+    bool MarchHits(const FPyramid& P, const FVec3& Dir, const FBox& B)
+    {
+        if (B.Min.X > B.Max.X || B.Min.Y > B.Max.Y || B.Min.Z > B.Max.Z)
+            return false;
+        const FVec3 Center = { (B.Min.X + B.Max.X) * 0.5 - P.Origin.X, (B.Min.Y + B.Max.Y) * 0.5 - P.Origin.Y,
+            (B.Min.Z + B.Max.Z) * 0.5 - P.Origin.Z };
+        const FVec3 Half = { (B.Max.X - B.Min.X) * 0.5, (B.Max.Y - B.Min.Y) * 0.5, (B.Max.Z - B.Min.Z) * 0.5 };
+        const double Radius = std::sqrt(Dot(Half, Half));
+        const double Dist = std::sqrt(Dot(Center, Center));
+        const double T0 = std::max(0.0, Dist - Radius);
+        const double T1 = std::min(P.MaxRange, Dist + Radius);
+        for (double T = T0; T <= T1; T += Step)
+        {
+            if (Inside({ P.Origin.X + Dir.X * T, P.Origin.Y + Dir.Y * T, P.Origin.Z + Dir.Z * T }, B))
+                return true;
+        }
+        return T1 >= T0 && Inside({ P.Origin.X + Dir.X * T1, P.Origin.Y + Dir.Y * T1, P.Origin.Z + Dir.Z * T1 }, B);
+    }
+
+    // Rasterizes without padding and compares against Expected(i, j)
+    template <typename FExpected>
+    void CheckCells(const char* Case, const FPyramid& P, const FBox& Box, FExpected&& Expected)
+    {
+        std::vector<uint8_t> Covered(size_t(P.Width) * P.Height);
+        const int32_t N = PeripheralRaster::Rasterize(P, Box, Covered.data(), 0.0);
+        int32_t Count = 0;
+        for (int j = 0; j < P.Height; ++j)
+        {
+            for (int i = 0; i < P.Width; ++i)
+            {
+                const bool bWant = Expected(i, j);
+                Count += Covered[j * P.Width + i];
+                if (bool(Covered[j * P.Width + i]) != bWant)
+                    Fail(Case, bWant ? "cell missed" : "cell wrongly covered", i, j);
+            }
+        }
+        if (N != Count)
+        {
+            ++Failures;
+            std::fprintf(stderr, "%s: returned %d covered cells, grid has %d\n", Case, N, Count);
+        }
+    }
+
+    // Axis-aligned pyramid looking down +X (right +Y, up +Z) and walls with known coverage
+    void ClosedForm(const FLayout& L)
+    {
+        const FPyramid P = L.Pyramid({ 0.0, 0.0, 0.0 }, { 1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 }, { 0.0, 0.0, 1.0 });
+        const double D = 5000.0;
+
+        // Wall 1 uu thick at depth D. A cell's ray crosses it at Y = D * NormX * HorzScale (to within
+        // 1/D of the cell spacing), so edges halfway between two cells' rays cover exactly the cells between.
+        auto ColumnEdge = [&](int I) { return D * P.HorzScale * 0.5 * (L.ColumnNorms[I] + L.ColumnNorms[I + 1]); };
+        auto RowEdge = [&](int J) { return D * P.VertScale * 0.5 * (L.RowNorms[J] + L.RowNorms[J + 1]); };
+        const int Spans[][4] = {
+            { 2, 5, 3, 7 },                          // upper left
+            { L.W / 2, L.W / 2, L.H / 2, L.H / 2 },  // boresight cell only
+            { 0, L.W - 1, 0, L.H - 1 },              // whole grid
+            { L.W - 4, L.W - 1, L.H - 2, L.H - 1 },  // lower right corner
+        };
+        for (const auto& S : Spans)
+        {
+            const int I0 = S[0], I1 = S[1], J0 = S[2], J1 = S[3];
+            const double Y0 = I0 > 0 ? ColumnEdge(I0 - 1) : -1e6;
+            const double Y1 = I1 < L.W - 1 ? ColumnEdge(I1) : 1e6;
+            const double Z1 = J0 > 0 ? RowEdge(J0 - 1) : 1e6;         // rows run top to bottom
+            const double Z0 = J1 < L.H - 1 ? RowEdge(J1) : -1e6;
+            const FBox Wall = { { D, Y0, Z0 }, { D + 1.0, Y1, Z1 } };
+            char Case[96];
+            std::snprintf(Case, sizeof(Case), "%s wall cols %d-%d rows %d-%d", L.bFoveated ? "foveated" : "even", I0, I1, J0, J1);
+            CheckCells(Case, P, Wall, [&](int i, int j) { return i >= I0 && i <= I1 && j >= J0 && j <= J1; });
+        }
+
+        const char* Prefix = L.bFoveated ? "foveated" : "even";
+        char Case[96];
+        auto None = [](int, int) { return false; };
+        auto All = [](int, int) { return true; };
+
+        std::snprintf(Case, sizeof(Case), "%s box behind", Prefix);
+        CheckCells(Case, P, { { -3000.0, -500.0, -500.0 }, { -1000.0, 500.0, 500.0 } }, None);
+
+        std::snprintf(Case, sizeof(Case), "%s box beyond range", Prefix);
+        CheckCells(Case, P, { { Range + 10.0, -5000.0, -5000.0 }, { Range + 500.0, 5000.0, 5000.0 } }, None);
+
+        std::snprintf(Case, sizeof(Case), "%s box around origin", Prefix);
+        CheckCells(Case, P, { { -50.0, -50.0, -50.0 }, { 50.0, 50.0, 50.0 } }, All);
+
+        // Well outside the widest ray (|Y| <= HorzScale * X) over its whole depth
+        std::snprintf(Case, sizeof(Case), "%s box out of view", Prefix);
+        CheckCells(Case, P, { { 1000.0, 0.5 * 1000.0, -100.0 }, { 2000.0, 0.5 * 1000.0 + 300.0, 100.0 } }, None);
+    }
+
+    // Random poses and boxes against the ray march
+    void Sampled(const FLayout& L, int Cases, std::mt19937& Rng)
+    {
+        std::uniform_real_distribution<double> Pos(-5000.0, 5000.0);
+        std::uniform_real_distribution<double> Depth(-0.1 * Range, 1.1 * Range);
+        std::uniform_real_distribution<double> Side(-1.3, 1.3);
+        std::uniform_real_distribution<double> Size(20.0, 800.0);
+        std::normal_distribution<double> Gauss;
+
+        std::vector<uint8_t> Covered(size_t(L.W) * L.H);
+        int Hit = 0;
+        for (int c = 0; c < Cases; ++c)
+        {
+            const FVec3 Forward = Normalize({ Gauss(Rng), Gauss(Rng), Gauss(Rng) });
+            const FVec3 WorldUp = std::fabs(Forward.Z) < 0.99 ? FVec3{ 0.0, 0.0, 1.0 } : FVec3{ 1.0, 0.0, 0.0 };
+            const FVec3 Right = Normalize(Cross(WorldUp, Forward));
+            const FPyramid P = L.Pyramid({ Pos(Rng), Pos(Rng), Pos(Rng) }, Forward, Right, Cross(Forward, Right));
+
+            const double F = Depth(Rng);
+            const double R = Side(Rng) * P.HorzScale * std::fabs(F);
+            const double U = Side(Rng) * P.VertScale * std::fabs(F);
+            const FVec3 C = {
+                P.Origin.X + P.Forward.X * F + P.Right.X * R + P.Up.X * U,
+                P.Origin.Y + P.Forward.Y * F + P.Right.Y * R + P.Up.Y * U,
+                P.Origin.Z + P.Forward.Z * F + P.Right.Z * R + P.Up.Z * U,
+            };
+            const FVec3 E = { Size(Rng), Size(Rng), Size(Rng) };
+            const FBox Box = { { C.X - E.X, C.Y - E.Y, C.Z - E.Z }, { C.X + E.X, C.Y + E.Y, C.Z + E.Z } };
+            const FBox Inner = Grow(Box, -Step);
+            const FBox Outer = Grow(Box, Step);
+
+            Hit += PeripheralRaster::Rasterize(P, Box, Covered.data(), 0.0) > 0;
+            for (int j = 0; j < L.H; ++j)
+            {
+                for (int i = 0; i < L.W; ++i)
+                {
+                    const FVec3 Dir = ReferenceRay(P, L, i, j);
+                    const bool bCovered = Covered[j * L.W + i] != 0;
+                    if (!bCovered && MarchHits(P, Dir, Inner))
+                        Fail(L.bFoveated ? "foveated march" : "even march", "ray march hits, cell missed", i, j);
+                    else if (bCovered && !MarchHits(P, Dir, Outer))
+                        Fail(L.bFoveated ? "foveated march" : "even march", "ray march misses, cell covered", i, j);
+                }
+            }
+        }
+        std::printf("%s grid %dx%d: %d sampled cases, %d in view\n", L.bFoveated ? "foveated" : "even", L.H, L.W, Cases, Hit);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int Cases = 300;
+    unsigned Seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool bHasValue = i + 1 < argc;
+        if (bHasValue && !std::strcmp(argv[i], "--cases")) Cases = std::atoi(argv[++i]);
+        else if (bHasValue && !std::strcmp(argv[i], "--seed")) Seed = unsigned(std::strtoul(argv[++i], nullptr, 10));
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--cases N] [--seed S]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::mt19937 Rng(Seed);
+    for (double Foveated : { 0.0, 0.33 })
+    {
+        const FLayout Layout(Foveated);
+        ClosedForm(Layout);
+        Sampled(Layout, Cases, Rng);
+    }
+
+    std::printf("failures %d\n", Failures);
+    return Failures == 0 ? 0 : 1;
+}
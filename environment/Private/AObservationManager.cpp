@@ -3,9 +3,11 @@
 #include "AObservationManager.h"
 #include "APeripheralPyramid.h"
 #include "AFovealCone.h"
+#include "EnvInstanceTags.h"
 #include "Engine/World.h"
 #include "EngineUtils.h"
 #include "GameFramework/PlayerController.h"
+#include "GameFramework/Controller.h"
 #include "DrawDebugHelpers.h"
 #include "Misc/FileHelper.h"
 #include "Misc/Paths.h"
@@ -56,15 +58,16 @@ void AObservationManager::InitializeComponents()
     UWorld* World = GetWorld();
     if (!World) return;
 
-    for (TActorIterator<APeripheralPyramid> It(World); It; ++It)
+    // Sensors of our own env instance only (untagged level = instance 0)
+    EnvIndex = EnvInstance::GetIndex(this);
+    PeripheralPyramid = EnvInstance::FindActor<APeripheralPyramid>(World, EnvIndex);
+    FovealCone = EnvInstance::FindActor<AFovealCone>(World, EnvIndex);
+    CachedAgent = EnvInstance::FindAgentPawn(World, EnvIndex);
+    CachedTarget = EnvInstance::FindTaggedActor(World, TEXT("Target"), EnvIndex);
+    if (PeripheralPyramid)
     {
-        PeripheralPyramid = *It;
-        break;
-    }
-    for (TActorIterator<AFovealCone> It(World); It; ++It)
-    {
-        FovealCone = *It;
-        break;
+        // With async traces the pyramid collects its batch in its own tick; read the flags after that
+        AddTickPrerequisiteActor(PeripheralPyramid);
     }
     if ((!PeripheralPyramid || !FovealCone) && bShowGridDebug)
     {
@@ -75,20 +78,47 @@ void AObservationManager::InitializeComponents()
 void AObservationManager::GenerateObservation()
 {
     if (!PeripheralPyramid || !FovealCone) return;
-    PeripheralFlags = PeripheralPyramid->ComputePeripheralFlags();
+    PeripheralFlags.SetNumUninitialized(PeripheralPyramid->GetWidth() * PeripheralPyramid->GetHeight(), EAllowShrinking::No);
+    PeripheralPyramid->ComputePeripheralFlagsInto(PeripheralFlags);
+}
+
+APawn* AObservationManager::FindAgent() const
+{
+    if (!CachedAgent.IsValid())
+    {
+        CachedAgent = EnvInstance::FindAgentPawn(GetWorld(), EnvIndex);
+    }
+    return CachedAgent.Get();
+}
+
+AActor* AObservationManager::FindTarget() const
+{
+    if (!CachedTarget.IsValid())
+    {
+        CachedTarget = EnvInstance::FindTaggedActor(GetWorld(), TEXT("Target"), EnvIndex);
+    }
+    return CachedTarget.Get();
 }
 
 TArray<float> AObservationManager::GetObservation() const
 {
-    // Prepare output array
     TArray<float> Combined;
-    Combined.Reserve(PeripheralFlags.Num() + 5);
-    Combined.Append(PeripheralFlags);
+    Combined.SetNumUninitialized(GetObservationLength());
+    WriteObservation(Combined);
+    return Combined;
+}
+
+void AObservationManager::WriteObservation(TArrayView<float> Out) const
+{
+    check(Out.Num() == GetObservationLength());
+    FMemory::Memcpy(Out.GetData(), PeripheralFlags.GetData(), PeripheralFlags.Num() * sizeof(float));
+    float* Scalars = Out.GetData() + PeripheralFlags.Num();
 
     // 1) Read and normalize controller rotation
     float Pitch = 0.0f;
     float Yaw = 0.0f;
-    if (APlayerController* PC = GetWorld()->GetFirstPlayerController())
+    APawn* Agent = FindAgent();
+    if (AController* PC = Agent ? Agent->GetController() : nullptr)
     {
         FRotator R = PC->GetControlRotation();
         Pitch = R.Pitch;
@@ -96,23 +126,15 @@ TArray<float> AObservationManager::GetObservation() const
     }
     float NormPitch = FMath::Clamp((Pitch - 4.0f) / (21.0f - 4.0f), 0.0f, 1.0f);
     float NormYaw = FMath::Clamp((Yaw - 253.0f) / (278.0f - 253.0f), 0.0f, 1.0f);
-    Combined.Add(NormPitch);
-    Combined.Add(NormYaw);
+    Scalars[0] = NormPitch;
+    Scalars[1] = NormYaw;
 
     // 2) Prepare for spatial metrics
     const FVector Origin = FovealCone->GetConeOrigin();
     const FVector Forward = FovealCone->GetConeForward();
 
-    // 3) Find the target actor
-    AActor* Target = nullptr;
-    for (TActorIterator<AActor> It(GetWorld()); It; ++It)
-    {
-        if (It->ActorHasTag(TEXT("Target")))
-        {
-            Target = *It;
-            break;
-        }
-    }
+    // 3) Find this instance's target actor
+    AActor* Target = FindTarget();
 
     // 4) Compute shared distance, cosine, and overlap
     float NormDist = 0.0f;
@@ -141,22 +163,19 @@ TArray<float> AObservationManager::GetObservation() const
             ECC_Visibility,
             Params
         );
-        if (bHit && Hit.GetActor() && Hit.GetActor()->ActorHasTag(TEXT("Target")))
+        if (bHit && Hit.GetActor() == Target)
         {
             Overlap = 1.0f;
         }
     }
 
     // 5) Append to observation
-    Combined.Add(NormDist);
-    Combined.Add(SignedNormAngle);
-    Combined.Add(Overlap);
+    Scalars[2] = NormDist;
+    Scalars[3] = SignedNormAngle;
+    Scalars[4] = Overlap;
 
     // 6) Debug log
     //UE_LOG(LogTemp, Log,TEXT("[Obs] NormPitch=%.3f NormYaw=%.3f NormDist=%.3f SignedAngle=%.3f Overlap=%.1f"),NormPitch, NormYaw, NormDist, SignedNormAngle, Overlap);
-
-
-    return Combined;
 }
 
 
@@ -3,12 +3,28 @@
 #include "Components/ArrowComponent.h"
 #include "DrawDebugHelpers.h"
 #include "URayUtils.h"
+#include "PeripheralRaster.h"
+#include "EnvInstanceTags.h"
 #include "Engine/World.h"
 #include "Math/UnrealMathUtility.h"
+#include "CoreGlobals.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Misc/App.h"
+
+namespace
+{
+    PeripheralRaster::FVec3 ToVec3(const FVector& V)
+    {
+        return { V.X, V.Y, V.Z };
+    }
+}
 
 APeripheralPyramid::APeripheralPyramid()
 {
-    PrimaryActorTick.bCanEverTick = false; // this was set to false, unsure what true does to it...
+    // Only ticks with bAsyncTraces, to collect and queue one batch of async traces per frame
+    PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.bStartWithTickEnabled = false;
 
     ArrowComponent = CreateDefaultSubobject<UArrowComponent>(TEXT("ArrowComponent"));
     RootComponent = ArrowComponent;
@@ -17,11 +33,41 @@ APeripheralPyramid::APeripheralPyramid()
     PeripheralPyramidAngleDegrees = 8.0f;
     PeripheralMaxRange = 15000.0f;
     bShowPeripheralRays = false; // CHANGE THIS TO FALSE TO TURN OFF RAYS
+    bFoveatedLayout = false;
+    FoveatedTraceFraction = 0.33f;
+    SensorMode = EPeripheralSensorMode::RayCast;
+    bAsyncTraces = false;
+    bParallelRays = false; // URayUtils::ComputeRayData isn't validated off the game thread yet
 }
 
 void APeripheralPyramid::BeginPlay()
 {
     Super::BeginPlay();
+    SetActorTickEnabled(bAsyncTraces && SensorMode == EPeripheralSensorMode::RayCast);
+}
+
+void APeripheralPyramid::Tick(float DeltaTime)
+{
+    Super::Tick(DeltaTime);
+
+    UWorld* World = GetWorld();
+    if (!World || !bAsyncTraces || SensorMode != EPeripheralSensorMode::RayCast)
+    {
+        // Switched off at runtime: drop the batch in flight and stop ticking until async mode is used again
+        PendingTraces.Reset();
+        AsyncFlags.Reset();
+        SetActorTickEnabled(false);
+        return;
+    }
+
+    EnsureRayTable();
+    UpdateWorldRays(ArrowComponent->GetForwardVector().GetSafeNormal(),
+        ArrowComponent->GetRightVector().GetSafeNormal(),
+        ArrowComponent->GetUpVector().GetSafeNormal());
+
+    // Every frame, whether or not anyone reads the flags, so last frame's batch is always there to collect
+    CollectAsyncTraces(World);
+    SubmitAsyncTraces(World, ArrowComponent->GetComponentLocation());
 }
 
 int32 APeripheralPyramid::GetWidth() const
@@ -36,50 +82,415 @@ int32 APeripheralPyramid::GetHeight() const
 }
 
 TArray<float> APeripheralPyramid::ComputePeripheralFlags()
+{
+    TArray<float> Flags;
+    Flags.SetNumUninitialized(GetWidth() * GetHeight());
+    ComputePeripheralFlagsInto(Flags);
+    return Flags;
+}
+
+void APeripheralPyramid::ComputePeripheralFlagsInto(TArrayView<float> OutFlags)
 {
     const int32 H = GetHeight();
     const int32 W = GetWidth();
-    const int32 Total = W * H;
-    TArray<float> Flags;
-    Flags.Reserve(Total);
+    check(OutFlags.Num() == W * H);
 
     FVector Origin = ArrowComponent->GetComponentLocation();
     FVector Forward = ArrowComponent->GetForwardVector().GetSafeNormal();
     FVector Right = ArrowComponent->GetRightVector().GetSafeNormal();
     FVector Up = ArrowComponent->GetUpVector().GetSafeNormal();
 
+    UWorld* World = GetWorld();
+    if (!World)
+    {
+        FMemory::Memzero(OutFlags.GetData(), OutFlags.Num() * sizeof(float));
+        return;
+    }
+
+    EnsureRayTable();
+    UpdateWorldRays(Forward, Right, Up);
+
+    // With the even layout the traced grid is the output grid and is written in place
+    const int32 NumRays = TracedWidth * TracedHeight;
+    const bool bRemap = NumRays != OutFlags.Num();
+    if (bRemap)
+    {
+        TracedFlags.SetNumUninitialized(NumRays, EAllowShrinking::No);
+    }
+    TArrayView<float> Traced = bRemap ? TArrayView<float>(TracedFlags) : OutFlags;
+
+    if (SensorMode == EPeripheralSensorMode::AnalyticRaster)
+    {
+        RasterizeInto(World, Origin, Forward, Right, Up, Traced);
+    }
+    else if (!bAsyncTraces)
+    {
+        TraceSync(World, Origin, Traced);
+    }
+    else
+    {
+        // Tick collects and queues the batches; turned on here too in case async mode was set after BeginPlay
+        if (!IsActorTickEnabled())
+        {
+            SetActorTickEnabled(true);
+        }
+        if (AsyncFlags.Num() != NumRays)
+        {
+            // Nothing collected yet (first frames, grid changed, resumed from pause): one synchronous pass
+            // with the same query, so the hit rule doesn't change between the two
+            AsyncFlags.SetNumUninitialized(NumRays, EAllowShrinking::No);
+            TraceAsyncQuery(World, Origin, AsyncFlags);
+        }
+        FMemory::Memcpy(Traced.GetData(), AsyncFlags.GetData(), NumRays * sizeof(float));
+    }
+
+    if (bRemap)
+    {
+        RemapToOutput(Traced, OutFlags);
+    }
+}
+
+int32 APeripheralPyramid::GetNumTracedRays()
+{
+    EnsureRayTable();
+    return TracedWidth * TracedHeight;
+}
+
+void APeripheralPyramid::RemapToOutput(TArrayView<const float> Traced, TArrayView<float> OutFlags) const
+{
+    // Every output cell takes the traced ray nearest to its own, evenly spaced, direction
+    const int32 W = RayTableWidth;
+    for (int32 j = 0; j < RayTableHeight; ++j)
+    {
+        const float* TracedRow = Traced.GetData() + OutputRowToTraced[j] * TracedWidth;
+        for (int32 i = 0; i < W; ++i)
+        {
+            OutFlags[j * W + i] = TracedRow[OutputColumnToTraced[i]];
+        }
+    }
+}
+
+void APeripheralPyramid::EnsureRayTable()
+{
+    const int32 H = GetHeight();
+    const int32 W = GetWidth();
+    const float Foveation = bFoveatedLayout ? FMath::Clamp(FoveatedTraceFraction, 0.05f, 1.0f) : 0.0f;
+    if (RayTableWidth == W && RayTableHeight == H && RayTableAngle == PeripheralPyramidAngleDegrees
+        && RayTableFoveation == Foveation)
+        return;
+
+    RayTableWidth = W;
+    RayTableHeight = H;
+    RayTableAngle = PeripheralPyramidAngleDegrees;
+    RayTableFoveation = Foveation;
+
     float MaxAngRad = FMath::DegreesToRadians(PeripheralPyramidAngleDegrees);
     float VertScale = FMath::Tan(MaxAngRad);
     float HorzScale = 1.5f * VertScale;
-    float CenterX = (W - 1) * 0.5f;
-    float CenterY = (H - 1) * 0.5f;
 
-    UWorld* World = GetWorld();
-    if (!World)
+    // Foveated: each axis keeps about sqrt(fraction) of its cells, packed towards the boresight so the
+    // centre spacing stays that of the full grid (PeripheralRaster::FoveatedNorms)
+    TracedWidth = Foveation > 0.0f ? PeripheralRaster::FoveatedCellCount(W, Foveation) : W;
+    TracedHeight = Foveation > 0.0f ? PeripheralRaster::FoveatedCellCount(H, Foveation) : H;
+
+    ColumnNorms.SetNumUninitialized(TracedWidth);
+    RowNorms.SetNumUninitialized(TracedHeight);
+    PeripheralRaster::FoveatedNorms(W, TracedWidth, ColumnNorms.GetData());   // i = 0 -> left
+    PeripheralRaster::FoveatedNorms(H, TracedHeight, RowNorms.GetData());
+
+    // Output cell -> nearest traced cell. Rows are mapped while still ascending; flipping both
+    // sides to top-down afterwards doesn't change which one is nearest.
+    OutputColumnToTraced.SetNumUninitialized(W);
+    OutputRowToTraced.SetNumUninitialized(H);
+    PeripheralRaster::NearestCells(ColumnNorms.GetData(), TracedWidth, W, OutputColumnToTraced.GetData());
+    PeripheralRaster::NearestCells(RowNorms.GetData(), TracedHeight, H, OutputRowToTraced.GetData());
+    for (double& NormY : RowNorms)
+    {
+        NormY = -NormY;   // j = 0 -> top
+    }
+
+    // Padded to whole vector registers; the tail rays are never read
+    const int32 Padded = Align(TracedWidth * TracedHeight, 4);
+    for (TArray<float>* Column : { &LocalRayX, &LocalRayY, &LocalRayZ, &WorldRayX, &WorldRayY, &WorldRayZ })
     {
-        Flags.Init(0.0f, Total);
-        return Flags;
+        Column->SetNumZeroed(Padded);
     }
 
-    // ROW-MAJOR: for each row (j) then each column (i)
-    for (int32 j = 0; j < H; ++j)         // j = 0 -> top
+    // Local frame of the arrow: X forward, Y right, Z up
+    for (int32 j = 0; j < TracedHeight; ++j)
     {
-        float NormY = (CenterY - j) / CenterY;
-        for (int32 i = 0; i < W; ++i)     // i = 0 -> left
+        for (int32 i = 0; i < TracedWidth; ++i)
         {
-            float NormX = (i - CenterX) / CenterX;
+            const FVector Local = FVector(1.0f, ColumnNorms[i] * HorzScale, RowNorms[j] * VertScale).GetSafeNormal();
+            LocalRayX[j * TracedWidth + i] = Local.X;
+            LocalRayY[j * TracedWidth + i] = Local.Y;
+            LocalRayZ[j * TracedWidth + i] = Local.Z;
+        }
+    }
+}
+
+void APeripheralPyramid::UpdateWorldRays(const FVector& Forward, const FVector& Right, const FVector& Up)
+{
+    // World = Forward * x + Right * y + Up * z. The basis is orthonormal, so the rays stay unit length.
+    const VectorRegister4Float FX = VectorSetFloat1(float(Forward.X));
+    const VectorRegister4Float FY = VectorSetFloat1(float(Forward.Y));
+    const VectorRegister4Float FZ = VectorSetFloat1(float(Forward.Z));
+    const VectorRegister4Float RX = VectorSetFloat1(float(Right.X));
+    const VectorRegister4Float RY = VectorSetFloat1(float(Right.Y));
+    const VectorRegister4Float RZ = VectorSetFloat1(float(Right.Z));
+    const VectorRegister4Float UX = VectorSetFloat1(float(Up.X));
+    const VectorRegister4Float UY = VectorSetFloat1(float(Up.Y));
+    const VectorRegister4Float UZ = VectorSetFloat1(float(Up.Z));
+
+    for (int32 k = 0; k < LocalRayX.Num(); k += 4)
+    {
+        const VectorRegister4Float LX = VectorLoad(&LocalRayX[k]);
+        const VectorRegister4Float LY = VectorLoad(&LocalRayY[k]);
+        const VectorRegister4Float LZ = VectorLoad(&LocalRayZ[k]);
+        VectorStore(VectorMultiplyAdd(FX, LX, VectorMultiplyAdd(RX, LY, VectorMultiply(UX, LZ))), &WorldRayX[k]);
+        VectorStore(VectorMultiplyAdd(FY, LX, VectorMultiplyAdd(RY, LY, VectorMultiply(UY, LZ))), &WorldRayY[k]);
+        VectorStore(VectorMultiplyAdd(FZ, LX, VectorMultiplyAdd(RZ, LY, VectorMultiply(UZ, LZ))), &WorldRayZ[k]);
+    }
+}
 
-            FVector Perturb = Right * (NormX * HorzScale)
-                + Up * (NormY * VertScale);
-            FVector Dir = (Forward + Perturb).GetSafeNormal();
+void APeripheralPyramid::TraceSync(UWorld* World, const FVector& Origin, TArrayView<float> OutFlags)
+{
+    const int32 H = TracedHeight;
+    const int32 W = TracedWidth;
 
-            float flag = URayUtils::ComputeRayData(Origin, Dir, PeripheralMaxRange, World).OnTargetInt;
-            Flags.Add(flag);
+    // Each ray writes only its own cell, so rows can be traced in any order and the buffer still comes out
+    // exactly as the serial loop would fill it. Running them on workers additionally assumes
+    // URayUtils::ComputeRayData is safe there, hence bParallelRays is opt-in.
+    auto TraceRows = [&](int32 RowBegin, int32 RowEnd)
+    {
+        for (int32 j = RowBegin; j < RowEnd; ++j)
+        {
+            for (int32 i = 0; i < W; ++i)
+            {
+                FVector Dir = GetRayDirection(j * W + i);
+                OutFlags[j * W + i] = URayUtils::ComputeRayData(Origin, Dir, PeripheralMaxRange, World).OnTargetInt;
+            }
+        }
+    };
+
+    if (bParallelRays && FApp::ShouldUseThreadingForPerformance())
+    {
+        // One contiguous chunk of rows per worker plus the game thread, which joins in
+        const int32 NumChunks = FMath::Clamp(FTaskGraphInterface::Get().GetNumWorkerThreads() + 1, 1, H);
+        const int32 RowsPerChunk = FMath::DivideAndRoundUp(H, NumChunks);
+        ParallelFor(NumChunks, [&](int32 Chunk)
+        {
+            TraceRows(Chunk * RowsPerChunk, FMath::Min(H, (Chunk + 1) * RowsPerChunk));
+        });
+    }
+    else
+    {
+        TraceRows(0, H);
+    }
+
+    // Debug drawing touches the line batcher, which is game-thread only
+    if (bShowPeripheralRays)
+    {
+        for (int32 j = 0; j < H; ++j)
+        {
+            for (int32 i = 0; i < W; ++i)
+            {
+                FVector Dir = GetRayDirection(j * W + i);
+                DrawDebugLine(World, Origin, Origin + Dir * PeripheralMaxRange, FColor::Green, false, 0, 0, 1.5f);
+            }
+        }
+    }
+}
+
+AActor* APeripheralPyramid::FindTarget(UWorld* World)
+{
+    if (!CachedTarget.IsValid())
+    {
+        CachedTarget = EnvInstance::FindTaggedActor(World, TEXT("Target"), EnvInstance::GetIndex(this));
+    }
+    return CachedTarget.Get();
+}
+
+void APeripheralPyramid::RasterizeInto(UWorld* World, const FVector& Origin, const FVector& Forward, const FVector& Right, const FVector& Up, TArrayView<float> OutFlags)
+{
+    const int32 H = TracedHeight;
+    const int32 W = TracedWidth;
+    FMemory::Memzero(OutFlags.GetData(), OutFlags.Num() * sizeof(float));
+
+    AActor* Target = FindTarget(World);
+    if (!Target)
+        return;
+
+    // Colliding components only: whatever a trace can hit lies inside this box
+    FVector BoundsOrigin, BoundsExtent;
+    Target->GetActorBounds(true, BoundsOrigin, BoundsExtent);
+    PeripheralRaster::FBox Box;
+    Box.Min = ToVec3(BoundsOrigin - BoundsExtent);
+    Box.Max = ToVec3(BoundsOrigin + BoundsExtent);
+
+    float VertScale = FMath::Tan(FMath::DegreesToRadians(PeripheralPyramidAngleDegrees));
+    PeripheralRaster::FPyramid Pyramid;
+    Pyramid.Origin = ToVec3(Origin);
+    Pyramid.Forward = ToVec3(Forward);
+    Pyramid.Right = ToVec3(Right);
+    Pyramid.Up = ToVec3(Up);
+    Pyramid.Width = W;
+    Pyramid.Height = H;
+    Pyramid.HorzScale = 1.5f * VertScale;
+    Pyramid.VertScale = VertScale;
+    Pyramid.MaxRange = PeripheralMaxRange;
+    Pyramid.ColumnNorms = ColumnNorms.GetData();
+    Pyramid.RowNorms = RowNorms.GetData();
+
+    RasterCovered.SetNumUninitialized(W * H, EAllowShrinking::No);
+    if (PeripheralRaster::Rasterize(Pyramid, Box, RasterCovered.GetData()) == 0)
+        return;
+
+    // Covered cells still need the real trace: something may stand in front of the target
+    for (int32 j = 0; j < H; ++j)
+    {
+        for (int32 i = 0; i < W; ++i)
+        {
+            if (!RasterCovered[j * W + i])
+                continue;
+
+            FVector Dir = GetRayDirection(j * W + i);
+            OutFlags[j * W + i] = URayUtils::ComputeRayData(Origin, Dir, PeripheralMaxRange, World).OnTargetInt;
 
             if (bShowPeripheralRays)
                 DrawDebugLine(World, Origin, Origin + Dir * PeripheralMaxRange, FColor::Green, false, 0, 0, 1.5f);
         }
     }
+}
 
-    return Flags;
+int32 APeripheralPyramid::CheckSensorConsistency()
+{
+    UWorld* World = GetWorld();
+    if (!World) return 0;
+
+    FVector Origin = ArrowComponent->GetComponentLocation();
+    FVector Forward = ArrowComponent->GetForwardVector().GetSafeNormal();
+    FVector Right = ArrowComponent->GetRightVector().GetSafeNormal();
+    FVector Up = ArrowComponent->GetUpVector().GetSafeNormal();
+
+    EnsureRayTable();
+    UpdateWorldRays(Forward, Right, Up);
+
+    // Compared on the traced grid, before any foveated remap
+    const int32 H = TracedHeight;
+    const int32 W = TracedWidth;
+    TArray<float> Traced, Rastered, AsyncQuery;
+    Traced.SetNumUninitialized(W * H);
+    Rastered.SetNumUninitialized(W * H);
+    AsyncQuery.SetNumUninitialized(W * H);
+    TraceSync(World, Origin, Traced);
+    RasterizeInto(World, Origin, Forward, Right, Up, Rastered);
+    TraceAsyncQuery(World, Origin, AsyncQuery);
+
+    int32 Hits = 0;
+    for (float Flag : Traced)
+    {
+        Hits += Flag > 0.5f;
+    }
+
+    auto Compare = [&](const TCHAR* Label, TArrayView<const float> Flags)
+    {
+        int32 Differ = 0;
+        for (int32 Cell = 0; Cell < W * H; ++Cell)
+        {
+            if (Traced[Cell] != Flags[Cell])
+            {
+                ++Differ;
+                UE_LOG(LogTemp, Warning, TEXT("PeripheralPyramid: cell (row %d, col %d) ray cast %.0f, %s %.0f"),
+                    Cell / W, Cell % W, Traced[Cell], Label, Flags[Cell]);
+            }
+        }
+        UE_LOG(LogTemp, Display, TEXT("PeripheralPyramid: %s vs ray cast, %d of %d cells differ (%d hits by ray cast)"),
+            Label, Differ, W * H, Hits);
+        return Differ;
+    };
+
+    // The async query run synchronously, so pose and world are exactly those of the ray cast
+    int32 Mismatches = Compare(TEXT("raster"), Rastered);
+    Mismatches += Compare(TEXT("async query"), AsyncQuery);
+
+    // Last flags the async batches delivered, one frame old, so only expected to agree while nothing moves
+    if (bAsyncTraces && AsyncFlags.Num() == W * H)
+    {
+        Mismatches += Compare(TEXT("async batch"), AsyncFlags);
+    }
+    return Mismatches;
+}
+
+bool APeripheralPyramid::CollectAsyncTraces(UWorld* World)
+{
+    // The world keeps results for one frame only, so a batch from further back (ticks paused) has been
+    // discarded, and one queued for another grid size doesn't fit. Either way the old flags are dropped too.
+    const int32 NumRays = TracedWidth * TracedHeight;
+    if (PendingTraces.Num() != NumRays || PendingFrame + 1 != GFrameCounter)
+    {
+        PendingTraces.Reset();
+        AsyncFlags.Reset();
+        return false;
+    }
+
+    AsyncFlags.SetNumUninitialized(NumRays, EAllowShrinking::No);
+    FTraceDatum Datum;
+    for (const FTraceHandle& Handle : PendingTraces)
+    {
+        if (!World->QueryTraceData(Handle, Datum))
+        {
+            PendingTraces.Reset();
+            AsyncFlags.Reset();
+            return false;
+        }
+        AsyncFlags[Datum.UserData] = IsTargetHit(Datum.OutHits.Num() > 0 ? &Datum.OutHits[0] : nullptr) ? 1.0f : 0.0f;
+    }
+    PendingTraces.Reset();
+    return true;
+}
+
+bool APeripheralPyramid::IsTargetHit(const FHitResult* Hit)
+{
+    const AActor* HitActor = Hit ? Hit->GetActor() : nullptr;
+    return HitActor && HitActor->ActorHasTag(TEXT("Target"));
+}
+
+void APeripheralPyramid::TraceAsyncQuery(UWorld* World, const FVector& Origin, TArrayView<float> OutFlags)
+{
+    const FCollisionQueryParams Params(SCENE_QUERY_STAT(PeripheralPyramid), false, this);
+    for (int32 Cell = 0; Cell < TracedWidth * TracedHeight; ++Cell)
+    {
+        FHitResult Hit;
+        const bool bHit = World->LineTraceSingleByChannel(Hit, Origin, Origin + GetRayDirection(Cell) * PeripheralMaxRange,
+            ECC_Visibility, Params);
+        OutFlags[Cell] = IsTargetHit(bHit ? &Hit : nullptr) ? 1.0f : 0.0f;
+    }
+}
+
+void APeripheralPyramid::SubmitAsyncTraces(UWorld* World, const FVector& Origin)
+{
+    const int32 H = TracedHeight;
+    const int32 W = TracedWidth;
+
+    FCollisionQueryParams Params(SCENE_QUERY_STAT(PeripheralPyramid), false, this);
+
+    PendingTraces.Reset(W * H);
+    for (int32 j = 0; j < H; ++j)
+    {
+        for (int32 i = 0; i < W; ++i)
+        {
+            FVector Dir = GetRayDirection(j * W + i);
+            FVector End = Origin + Dir * PeripheralMaxRange;
+
+            // UserData carries the cell index back, results don't depend on submission order
+            PendingTraces.Add(World->AsyncLineTraceByChannel(
+                EAsyncTraceType::Single, Origin, End, ECC_Visibility, Params,
+                FCollisionResponseParams::DefaultResponseParam, nullptr, static_cast<uint32>(j * W + i)));
+
+            if (bShowPeripheralRays)
+                DrawDebugLine(World, Origin, End, FColor::Green, false, 0, 0, 1.5f);
+        }
+    }
+    PendingFrame = GFrameCounter;
 }
@@ -2,6 +2,7 @@
 
 #include "ARewardManager.h"
 #include "AFovealCone.h"
+#include "EnvInstanceTags.h"
 #include "EngineUtils.h"
 #include "Math/UnrealMathUtility.h"
 #include "Engine/Engine.h"
@@ -21,12 +22,8 @@ void ARewardManager::BeginPlay()
 {
     Super::BeginPlay();
 
-    // Find the one FovealCone in the world
-    for (TActorIterator<AFovealCone> It(GetWorld()); It; ++It)
-    {
-        FovealConePtr = *It;
-        break;
-    }
+    // Find the FovealCone belonging to our env instance
+    FovealConePtr = EnvInstance::FindActor<AFovealCone>(GetWorld(), EnvInstance::GetIndex(this));
     if (!FovealConePtr && bShowDebug)
     {
         UE_LOG(LogTemp, Warning, TEXT("[RewardManager] No FovealCone found; shaping disabled."));
@@ -102,6 +99,10 @@ void ARewardManager::ComputeDistanceShaping()
 void ARewardManager::AddHitReward()
 {
     PendingReward += HitReward;
+    if (EpisodeHits++ == 0)
+    {
+        FirstHitTime = GetWorld() ? GetWorld()->GetTimeSeconds() : 0.0;
+    }
     if (bShowDebug && GEngine)
     {
         UE_LOG(LogTemp, Log, TEXT("[RewardManager] HitReward=+%.1f Pending=%.4f"), HitReward, PendingReward);
@@ -139,6 +140,8 @@ void ARewardManager::OnEpisodeReset()
     PendingReward = 0.f;
     LastPendingSnapshot = 0.f;
     LastNormDist = 0.0f;
+    EpisodeHits = 0;
+    FirstHitTime = -1.0;
 }
 
 // Getter for the most recent DeltaTime
@@ -0,0 +1,223 @@
+// EnvEndpoint.cpp
+#include "EnvEndpoint.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace EnvEndpoint
+{
+    namespace
+    {
+        bool StartsWith(const char* Text, const char* Prefix)
+        {
+            return std::strncmp(Text, Prefix, std::strlen(Prefix)) == 0;
+        }
+
+        bool ParsePort(const char* Text, uint16_t& Out)
+        {
+            char* End = nullptr;
+            const long V = std::strtol(Text, &End, 10);
+            if (End == Text || *End != '\0' || V <= 0 || V > 65535)
+                return false;
+            Out = static_cast<uint16_t>(V);
+            return true;
+        }
+    }
+
+    bool Parse(const char* Text, FEndpoint& Out)
+    {
+        if (!Text || !*Text)
+            return false;
+
+        FEndpoint E;
+        if (StartsWith(Text, "unix:"))
+        {
+            // "unix:///abs" and "unix:rel" both work; "unix://" is just the URL spelling
+            const char* Path = Text + 5;
+            if (StartsWith(Path, "//"))
+                Path += 2;
+            const size_t Len = std::strlen(Path);
+            if (Len == 0 || Len >= sizeof(E.Path))
+                return false;
+            E.Kind = EKind::Unix;
+            std::memcpy(E.Path, Path, Len + 1);
+            Out = E;
+            return true;
+        }
+
+        if (StartsWith(Text, "tcp://"))
+            Text += 6;
+
+        const char* Colon = std::strrchr(Text, ':');
+        if (!Colon)
+        {
+            // Bare port, keep the default host
+            if (!ParsePort(Text, E.Port))
+                return false;
+            Out = E;
+            return true;
+        }
+
+        const size_t HostLen = size_t(Colon - Text);
+        if (HostLen == 0 || HostLen >= sizeof(E.Host) || !ParsePort(Colon + 1, E.Port))
+            return false;
+        std::memcpy(E.Host, Text, HostLen);
+        E.Host[HostLen] = '\0';
+        Out = E;
+        return true;
+    }
+
+    void Format(const FEndpoint& E, char* Buf, size_t BufLen)
+    {
+        if (E.Kind == EKind::Unix)
+            std::snprintf(Buf, BufLen, "unix://%s", E.Path);
+        else
+            std::snprintf(Buf, BufLen, "tcp://%s:%u", E.Host, unsigned(E.Port));
+    }
+
+#if !defined(_WIN32)
+    namespace
+    {
+        // A peer that went away must fail the send, not raise SIGPIPE. Linux takes that per call; macOS
+        // has no MSG_NOSIGNAL and sets SO_NOSIGPIPE on the socket instead (NoSigPipe)
+#if defined(MSG_NOSIGNAL)
+        constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+        constexpr int SendFlags = 0;
+#endif
+
+        void NoSigPipe(int Fd)
+        {
+#if defined(SO_NOSIGPIPE)
+            const int On = 1;
+            setsockopt(Fd, SOL_SOCKET, SO_NOSIGPIPE, &On, sizeof(On));
+#else
+            (void)Fd;
+#endif
+        }
+    }
+
+    bool SupportsUnixSockets()
+    {
+        return true;
+    }
+
+    int ListenUnix(const char* Path)
+    {
+        sockaddr_un Addr = {};
+        Addr.sun_family = AF_UNIX;
+        if (std::strlen(Path) >= sizeof(Addr.sun_path))
+            return -1;
+        std::strcpy(Addr.sun_path, Path);
+
+        const int Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (Fd < 0)
+            return -1;
+
+        // A file left behind by a crashed run would make bind fail with EADDRINUSE
+        unlink(Path);
+        if (bind(Fd, reinterpret_cast<sockaddr*>(&Addr), sizeof(Addr)) != 0 || listen(Fd, 1) != 0)
+        {
+            close(Fd);
+            return -1;
+        }
+        fcntl(Fd, F_SETFL, fcntl(Fd, F_GETFL, 0) | O_NONBLOCK);
+        return Fd;
+    }
+
+    int AcceptUnix(int ListenFd)
+    {
+        const int Fd = accept(ListenFd, nullptr, nullptr);
+        if (Fd < 0)
+            return -1;
+        // Accepted sockets inherit O_NONBLOCK on some platforms
+        fcntl(Fd, F_SETFL, fcntl(Fd, F_GETFL, 0) & ~O_NONBLOCK);
+        NoSigPipe(Fd);
+        return Fd;
+    }
+
+    int ConnectUnix(const char* Path)
+    {
+        sockaddr_un Addr = {};
+        Addr.sun_family = AF_UNIX;
+        if (std::strlen(Path) >= sizeof(Addr.sun_path))
+            return -1;
+        std::strcpy(Addr.sun_path, Path);
+
+        const int Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (Fd < 0)
+            return -1;
+        if (connect(Fd, reinterpret_cast<sockaddr*>(&Addr), sizeof(Addr)) != 0)
+        {
+            close(Fd);
+            return -1;
+        }
+        NoSigPipe(Fd);
+        return Fd;
+    }
+
+    void CloseUnix(int Fd, const char* UnlinkPath)
+    {
+        if (Fd >= 0)
+            close(Fd);
+        if (UnlinkPath && *UnlinkPath)
+            unlink(UnlinkPath);
+    }
+
+    void ShutdownUnix(int Fd)
+    {
+        if (Fd >= 0)
+            shutdown(Fd, SHUT_RDWR);
+    }
+
+    bool SendSome(int Fd, const uint8_t* Data, int32_t Len, int32_t& Sent)
+    {
+        const ssize_t N = send(Fd, Data, size_t(Len), SendFlags);
+        if (N < 0)
+        {
+            Sent = 0;
+            return errno == EINTR;
+        }
+        Sent = int32_t(N);
+        return true;
+    }
+
+    bool RecvSome(int Fd, uint8_t* Dst, int32_t Len, int32_t& Read)
+    {
+        const ssize_t N = recv(Fd, Dst, size_t(Len), 0);
+        if (N < 0)
+        {
+            Read = 0;
+            return errno == EINTR;
+        }
+        Read = int32_t(N);
+        return N > 0;
+    }
+
+    bool CanWriteNow(int Fd)
+    {
+        pollfd P = { Fd, POLLOUT, 0 };
+        return poll(&P, 1, 0) > 0 && (P.revents & POLLOUT) != 0;
+    }
+#else
+    bool SupportsUnixSockets() { return false; }
+    int  ListenUnix(const char*) { return -1; }
+    int  AcceptUnix(int) { return -1; }
+    int  ConnectUnix(const char*) { return -1; }
+    void CloseUnix(int, const char*) {}
+    void ShutdownUnix(int) {}
+    bool SendSome(int, const uint8_t*, int32_t, int32_t& Sent) { Sent = 0; return false; }
+    bool RecvSome(int, uint8_t*, int32_t, int32_t& Read) { Read = 0; return false; }
+    bool CanWriteNow(int) { return false; }
+#endif
+}
@@ -0,0 +1,120 @@
+// EnvSharedMemory.cpp
+#include "EnvSharedMemory.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#if defined(PLATFORM_WINDOWS)
+#include "Windows/AllowWindowsPlatformTypes.h"
+#include <windows.h>
+#include "Windows/HideWindowsPlatformTypes.h"
+#else
+#include <windows.h>
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace EnvShm
+{
+    bool FRing::Create(const char* InName, uint32_t InSlotCount, uint32_t InObsCapacity)
+    {
+        Close();
+        if (InSlotCount == 0 || InSlotCount > MaxSlotCount || InObsCapacity == 0 || InObsCapacity > MaxObsCapacity)
+            return false;
+
+        const size_t Bytes = sizeof(FRingHeader) + size_t(InSlotCount) * SlotStride(InObsCapacity);
+
+#if defined(_WIN32)
+        std::snprintf(Name, sizeof(Name), "%s", InName);
+        HANDLE H = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+            static_cast<DWORD>(uint64_t(Bytes) >> 32), static_cast<DWORD>(Bytes & 0xFFFFFFFFu), Name);
+        if (!H)
+            return false;
+        void* View = MapViewOfFile(H, FILE_MAP_ALL_ACCESS, 0, 0, Bytes);
+        if (!View)
+        {
+            CloseHandle(H);
+            return false;
+        }
+        Mapping = H;
+#else
+        // POSIX shm names need a single leading slash
+        std::snprintf(Name, sizeof(Name), "/%s", InName);
+        shm_unlink(Name);  // stale region from a crashed run
+        const int Fd = shm_open(Name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (Fd < 0)
+            return false;
+        if (ftruncate(Fd, static_cast<off_t>(Bytes)) != 0)
+        {
+            close(Fd);
+            shm_unlink(Name);
+            return false;
+        }
+        void* View = mmap(nullptr, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+        close(Fd);
+        if (View == MAP_FAILED)
+        {
+            shm_unlink(Name);
+            return false;
+        }
+#endif
+
+        Base = static_cast<uint8_t*>(View);
+        Size = Bytes;
+        SlotCount = InSlotCount;
+        ObsCapacity = InObsCapacity;
+
+        FRingHeader Header = {};
+        Header.Magic = Magic;
+        Header.Version = Version;
+        Header.SlotCount = SlotCount;
+        Header.ObsCapacity = ObsCapacity;
+        Header.SlotStride = static_cast<uint32_t>(SlotStride(ObsCapacity));
+        std::memcpy(Base, &Header, sizeof(Header));
+        return true;
+    }
+
+    void FRing::Close()
+    {
+        if (!Base)
+            return;
+
+#if defined(_WIN32)
+        UnmapViewOfFile(Base);
+        CloseHandle(static_cast<HANDLE>(Mapping));
+        Mapping = nullptr;
+#else
+        munmap(Base, Size);
+        shm_unlink(Name);
+#endif
+        Base = nullptr;
+        Size = 0;
+        SlotCount = 0;
+        ObsCapacity = 0;
+    }
+
+    uint32_t FRing::CommitRecord(float Reward, bool bDone, float DeltaTime, uint32_t ObsLen)
+    {
+        FRingHeader* Header = reinterpret_cast<FRingHeader*>(Base);
+        const uint32_t Slot = static_cast<uint32_t>(Header->WriteSeq % SlotCount);
+        EnvWire::FStepRecord R;
+        R.Reward = Reward;
+        R.DeltaTime = DeltaTime;
+        R.Done = bDone ? 1u : 0u;
+        R.ObsLen = ObsLen;
+        std::memcpy(SlotData(Slot), &R, sizeof(R));
+        ++Header->WriteSeq;
+        return Slot;
+    }
+
+    uint32_t FRing::WriteRecord(float Reward, bool bDone, float DeltaTime, const float* Obs, uint32_t ObsLen)
+    {
+        if (ObsLen > 0)
+            std::memcpy(BeginRecord(), Obs, size_t(ObsLen) * sizeof(float));
+        return CommitRecord(Reward, bDone, DeltaTime, ObsLen);
+    }
+}
@@ -0,0 +1,121 @@
+// EnvSnapshot.cpp
+#include "EnvSnapshot.h"
+#include "EnvInstanceTags.h"
+#include "Components/PrimitiveComponent.h"
+#include "GameFramework/MovementComponent.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "Engine/World.h"
+
+namespace
+{
+    bool HasAnyTag(const AActor* Actor, TArrayView<const FName> Tags)
+    {
+        for (const FName& Tag : Tags)
+        {
+            if (Actor->ActorHasTag(Tag))
+                return true;
+        }
+        return false;
+    }
+
+    void SeedRandom(int32 Seed)
+    {
+        FMath::RandInit(Seed);
+        FMath::SRandInit(Seed);
+    }
+}
+
+void EnvSnapshot::Capture(UWorld* World, int32 EnvIndex, TArrayView<const FName> Tags, int32 Seed, FEnvSnapshot& Out)
+{
+    Out.Actors.Reset();
+    Out.RandomSeed = Seed;
+    if (!World) return;
+
+    for (TActorIterator<AActor> It(World); It; ++It)
+    {
+        AActor* Actor = *It;
+        if (!HasAnyTag(Actor, Tags) || EnvInstance::GetIndex(Actor) != EnvIndex)
+            continue;
+
+        FEnvActorState& State = Out.Actors.AddDefaulted_GetRef();
+        State.Actor = Actor;
+        State.Transform = Actor->GetActorTransform();
+        State.bHidden = Actor->IsHidden();
+
+        UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Actor->GetRootComponent());
+        if (Root && Root->IsSimulatingPhysics())
+        {
+            State.LinearVelocity = Root->GetPhysicsLinearVelocity();
+            State.AngularVelocity = Root->GetPhysicsAngularVelocityInDegrees();
+        }
+        else if (UMovementComponent* Move = Actor->FindComponentByClass<UMovementComponent>())
+        {
+            State.LinearVelocity = Move->Velocity;
+        }
+
+        // Only properties flagged SaveGame make it into the archive
+        FMemoryWriter Writer(State.SaveGameData);
+        FObjectAndNameAsStringProxyArchive Ar(Writer, true);
+        Ar.ArIsSaveGame = true;
+        Actor->Serialize(Ar);
+    }
+
+    SeedRandom(Seed);
+}
+
+int32 EnvSnapshot::Restore(UWorld* World, int32 EnvIndex, TArrayView<const FName> TransientTags, const FEnvSnapshot& Snapshot)
+{
+    if (!World) return 0;
+
+    int32 Restored = 0;
+    for (const FEnvActorState& State : Snapshot.Actors)
+    {
+        AActor* Actor = State.Actor.Get();
+        if (!Actor)
+            continue;
+
+        Actor->SetActorTransform(State.Transform, false, nullptr, ETeleportType::ResetPhysics);
+        Actor->SetActorHiddenInGame(State.bHidden);
+
+        UPrimitiveComponent* Root = Cast<UPrimitiveComponent>(Actor->GetRootComponent());
+        if (Root && Root->IsSimulatingPhysics())
+        {
+            Root->SetPhysicsLinearVelocity(State.LinearVelocity);
+            Root->SetPhysicsAngularVelocityInDegrees(State.AngularVelocity);
+        }
+        else if (UMovementComponent* Move = Actor->FindComponentByClass<UMovementComponent>())
+        {
+            Move->Velocity = State.LinearVelocity;
+            Move->UpdateComponentVelocity();
+        }
+
+        if (State.SaveGameData.Num() > 0)
+        {
+            FMemoryReader Reader(State.SaveGameData);
+            FObjectAndNameAsStringProxyArchive Ar(Reader, true);
+            Ar.ArIsSaveGame = true;
+            Actor->Serialize(Ar);
+        }
+        ++Restored;
+    }
+
+    // Whatever was spawned since the capture (projectiles in flight) doesn't belong in the restored state
+    if (TransientTags.Num() > 0)
+    {
+        for (TActorIterator<AActor> It(World); It; ++It)
+        {
+            AActor* Actor = *It;
+            if (!HasAnyTag(Actor, TransientTags) || EnvInstance::GetIndex(Actor) != EnvIndex)
+                continue;
+            const bool bCaptured = Snapshot.Actors.ContainsByPredicate(
+                [Actor](const FEnvActorState& State) { return State.Actor.Get() == Actor; });
+            if (!bCaptured)
+                Actor->Destroy();
+        }
+    }
+
+    SeedRandom(Snapshot.RandomSeed);
+    return Restored;
+}
@@ -0,0 +1,211 @@
+// PeripheralRaster.cpp
+#include "PeripheralRaster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace PeripheralRaster
+{
+    namespace
+    {
+        double Dot(const FVec3& A, const FVec3& B)
+        {
+            return A.X * B.X + A.Y * B.Y + A.Z * B.Z;
+        }
+
+        FVec3 Sub(const FVec3& A, const FVec3& B)
+        {
+            return { A.X - B.X, A.Y - B.Y, A.Z - B.Z };
+        }
+
+        double CenterOf(int32_t Cells)
+        {
+            return (Cells - 1) * 0.5;
+        }
+
+        // Same normalisation as APeripheralPyramid: -1..1 across the grid, 0 for a single cell
+        double NormAt(double Cell, double Center)
+        {
+            return Center > 0.0 ? (Cell - Center) / Center : 0.0;
+        }
+
+        // Fractional index of V among N norms ascending (Sign = 1) or descending (Sign = -1).
+        // Past either end it lands just outside [0, N - 1].
+        double Position(const double* Norms, int32_t N, double V, double Sign)
+        {
+            auto At = [&](int32_t K) { return Norms[K] * Sign; };
+            V *= Sign;
+            if (V <= At(0))
+                return V < At(0) ? -1.0 : 0.0;
+            if (V >= At(N - 1))
+                return V > At(N - 1) ? double(N) : double(N - 1);
+            int32_t Lo = 0, Hi = N - 1;
+            while (Hi - Lo > 1)
+            {
+                const int32_t Mid = (Lo + Hi) / 2;
+                (At(Mid) <= V ? Lo : Hi) = Mid;
+            }
+            return Lo + (V - At(Lo)) / (At(Hi) - At(Lo));
+        }
+
+        // Slab test on one axis; narrows [TEnter, TExit] or reports a miss
+        bool ClipAxis(double Origin, double Dir, double Min, double Max, double& TEnter, double& TExit)
+        {
+            if (std::fabs(Dir) < 1e-12)
+                return Origin >= Min && Origin <= Max;
+            double T0 = (Min - Origin) / Dir;
+            double T1 = (Max - Origin) / Dir;
+            if (T0 > T1)
+                std::swap(T0, T1);
+            TEnter = std::max(TEnter, T0);
+            TExit = std::min(TExit, T1);
+            return TEnter <= TExit;
+        }
+    }
+
+    FVec3 FPyramid::RayDirection(int32_t I, int32_t J) const
+    {
+        const double NormX = ColumnNorms ? ColumnNorms[I] : NormAt(I, CenterOf(Width));
+        const double NormY = RowNorms ? RowNorms[J] : -NormAt(J, CenterOf(Height));
+        const double SX = NormX * HorzScale;
+        const double SY = NormY * VertScale;
+
+        FVec3 D = {
+            Forward.X + Right.X * SX + Up.X * SY,
+            Forward.Y + Right.Y * SX + Up.Y * SY,
+            Forward.Z + Right.Z * SX + Up.Z * SY,
+        };
+        const double Len = std::sqrt(Dot(D, D));
+        if (Len > 0.0)
+        {
+            D.X /= Len;
+            D.Y /= Len;
+            D.Z /= Len;
+        }
+        return D;
+    }
+
+    bool CellHitsBox(const FPyramid& Pyramid, const FBox& Box, int32_t I, int32_t J, double Pad)
+    {
+        const FVec3 D = Pyramid.RayDirection(I, J);
+        const FVec3& O = Pyramid.Origin;
+        double TEnter = 0.0;
+        double TExit = Pyramid.MaxRange;
+        return ClipAxis(O.X, D.X, Box.Min.X - Pad, Box.Max.X + Pad, TEnter, TExit)
+            && ClipAxis(O.Y, D.Y, Box.Min.Y - Pad, Box.Max.Y + Pad, TEnter, TExit)
+            && ClipAxis(O.Z, D.Z, Box.Min.Z - Pad, Box.Max.Z + Pad, TEnter, TExit);
+    }
+
+    int32_t Rasterize(const FPyramid& Pyramid, const FBox& Box, uint8_t* OutCovered, double Pad)
+    {
+        const int32_t W = Pyramid.Width;
+        const int32_t H = Pyramid.Height;
+        if (W <= 0 || H <= 0)
+            return 0;
+        std::memset(OutCovered, 0, size_t(W) * size_t(H));
+
+        const double CenterX = CenterOf(W);
+        const double CenterY = CenterOf(H);
+
+        // Project the padded box's corners to NormX = x / (f * HorzScale), NormY = y / (f * VertScale),
+        // with f the depth along Forward, then to fractional column and row indices
+        int32_t I0 = 0, I1 = W - 1, J0 = 0, J1 = H - 1;
+        bool bAllInFront = Pyramid.HorzScale > 0.0 && Pyramid.VertScale > 0.0;
+        bool bAnyInFront = false;
+        double MinCol = 1e300, MaxCol = -1e300, MinRow = 1e300, MaxRow = -1e300;
+        for (int32_t Corner = 0; Corner < 8; ++Corner)
+        {
+            const FVec3 P = {
+                (Corner & 1) ? Box.Max.X + Pad : Box.Min.X - Pad,
+                (Corner & 2) ? Box.Max.Y + Pad : Box.Min.Y - Pad,
+                (Corner & 4) ? Box.Max.Z + Pad : Box.Min.Z - Pad,
+            };
+            const FVec3 Rel = Sub(P, Pyramid.Origin);
+            const double F = Dot(Rel, Pyramid.Forward);
+            bAnyInFront |= F > 0.0;
+            if (F <= 1e-6)
+            {
+                bAllInFront = false;
+                continue;
+            }
+            const double NormX = Dot(Rel, Pyramid.Right) / (F * Pyramid.HorzScale);
+            const double NormY = Dot(Rel, Pyramid.Up) / (F * Pyramid.VertScale);
+            const double Col = Pyramid.ColumnNorms ? Position(Pyramid.ColumnNorms, W, NormX, 1.0) : CenterX + NormX * CenterX;
+            const double Row = Pyramid.RowNorms ? Position(Pyramid.RowNorms, H, NormY, -1.0) : CenterY - NormY * CenterY;
+            MinCol = std::min(MinCol, Col);
+            MaxCol = std::max(MaxCol, Col);
+            MinRow = std::min(MinRow, Row);
+            MaxRow = std::max(MaxRow, Row);
+        }
+
+        // Every ray points forward, so a box wholly behind the origin can't be hit
+        if (!bAnyInFront)
+            return 0;
+
+        // A box straddling the origin's plane has no bounded projection; test the whole grid
+        if (bAllInFront)
+        {
+            if (MaxCol < 0.0 || MinCol > W - 1 || MaxRow < 0.0 || MinRow > H - 1)
+                return 0;
+            I0 = std::max<int32_t>(0, int32_t(std::floor(MinCol)));
+            I1 = std::min<int32_t>(W - 1, int32_t(std::ceil(MaxCol)));
+            J0 = std::max<int32_t>(0, int32_t(std::floor(MinRow)));
+            J1 = std::min<int32_t>(H - 1, int32_t(std::ceil(MaxRow)));
+        }
+
+        int32_t Covered = 0;
+        for (int32_t J = J0; J <= J1; ++J)
+        {
+            for (int32_t I = I0; I <= I1; ++I)
+            {
+                if (CellHitsBox(Pyramid, Box, I, J, Pad))
+                {
+                    OutCovered[J * W + I] = 1;
+                    ++Covered;
+                }
+            }
+        }
+        return Covered;
+    }
+
+    int32_t FoveatedCellCount(int32_t OutputCells, double Fraction)
+    {
+        if (OutputCells <= 2 || Fraction >= 1.0)
+            return OutputCells;
+        int32_t Cells = int32_t(std::lround(OutputCells * std::sqrt(std::max(Fraction, 0.0))));
+        if ((OutputCells - Cells) % 2 != 0)
+            ++Cells;
+        return std::min(OutputCells, std::max<int32_t>(2, Cells));
+    }
+
+    void FoveatedNorms(int32_t OutputCells, int32_t TracedCells, double* OutNorms)
+    {
+        if (TracedCells <= 1)
+        {
+            if (TracedCells == 1)
+                OutNorms[0] = 0.0;
+            return;
+        }
+        // Slope at the centre = traced spacing over output spacing; <= 1 keeps the warp monotonic
+        const double A = OutputCells > 1 ? std::min(1.0, double(TracedCells - 1) / double(OutputCells - 1)) : 1.0;
+        for (int32_t K = 0; K < TracedCells; ++K)
+        {
+            const double T = NormAt(K, CenterOf(TracedCells));
+            OutNorms[K] = A * T + (1.0 - A) * T * T * T;
+        }
+    }
+
+    void NearestCells(const double* Norms, int32_t TracedCells, int32_t OutputCells, int32_t* OutMap)
+    {
+        // Both sides ascending, so the nearest traced cell only ever moves forward
+        int32_t K = 0;
+        for (int32_t O = 0; O < OutputCells; ++O)
+        {
+            const double U = NormAt(O, CenterOf(OutputCells));
+            while (K + 1 < TracedCells && std::fabs(Norms[K + 1] - U) <= std::fabs(Norms[K] - U))
+                ++K;
+            OutMap[O] = K;
+        }
+    }
+}
@@ -5,23 +5,189 @@
 #include "Json.h"
 #include "JsonUtilities.h"
 #include "UE5Game.h"
+#include "EnvWireFormat.h"
+#include "EnvInstanceTags.h"
+#include "AObservationManager.h"
 #include "Engine/Engine.h"
 #include "Engine/World.h"
 #include "Kismet/GameplayStatics.h"
-#include "Async/Async.h"
 #include "HAL/PlatformProcess.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/App.h"
+#include "Misc/Compression.h"
+#include "Engine/GameViewportClient.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace
+{
+    // Hard cap on step_n segments so a bad request can't pin the game thread
+    constexpr int32 MaxStepsPerRequest = 4096;
+
+    constexpr int32 NumPhases = static_cast<int32>(EnvTelemetry::EPhase::Count);
+
+    uint32 CyclesToMicros(uint64 From, uint64 To)
+    {
+        if (From == 0 || To <= From)
+            return 0;
+        return static_cast<uint32>(FMath::Min(FPlatformTime::ToSeconds64(To - From) * 1e6, double(MAX_uint32)));
+    }
+
+    FEnvAction ParseAction(const TArray<TSharedPtr<FJsonValue>>& JA)
+    {
+        FEnvAction A;
+        if (JA.Num() >= 3)
+        {
+            A.Pitch = JA[0]->AsNumber();
+            A.Yaw = JA[1]->AsNumber();
+            A.Fire = static_cast<int32>(JA[2]->AsNumber());
+        }
+        return A;
+    }
+
+    // Error reply for a request naming an env instance the world doesn't have
+    void SetNoSuchEnv(const TSharedPtr<FJsonObject>& Resp, const FEnvCommand& Cmd)
+    {
+        Resp->SetStringField(TEXT("status"), TEXT("error"));
+        Resp->SetNumberField(TEXT("env"), Cmd.EnvIndex);
+        Resp->SetNumberField(TEXT("num_envs"), Cmd.NumEnvs);
+    }
+
+    /**
+     * Produces Cmd's next result with Fill, one of the UUE5Game *Into calls wrapped to return true once it
+     * wrote a result. With Cmd.bToRing it writes into the next ring slot (and the auto-reset observation
+     * into the slot after it) and publishes the record, otherwise into the next pooled FStepResult.
+     */
+    template <typename FillFn>
+    bool FillNextResult(FEnvCommand& Cmd, EnvShm::FRing& Ring, UUE5Game& Instance, FillFn&& Fill)
+    {
+        if (!Cmd.bToRing)
+        {
+            FStepResult& SR = Cmd.PendingResult();
+            if (!Fill(SR))
+                return false;
+            Cmd.AddResult();
+            Cmd.bLastDone = SR.Done;
+            return true;
+        }
+
+        Instance.BindManagers();
+        const int32 ObsLen = Instance.GetObservationLength();
+        FStepOutput Out;
+        Out.Obs = TArrayView<float>(Ring.BeginRecord(0), ObsLen);
+        if (Cmd.bAutoReset)
+            Out.ResetObs = TArrayView<float>(Ring.BeginRecord(1), ObsLen);
+        if (!Fill(Out))
+            return false;
+
+        const uint32 Slot = Ring.CommitRecord(Out.Reward, Out.Done, Out.DeltaTime, static_cast<uint32>(ObsLen));
+        if (Cmd.NumResults++ == 0)
+            Cmd.FirstRingSlot = Slot;
+        if (Cmd.bAutoReset && Out.Done)
+            Ring.CommitRecord(0.0f, false, 0.0f, static_cast<uint32>(ObsLen));
+        Cmd.bLastDone = Out.Done;
+        return true;
+    }
+
+    TSharedPtr<FJsonObject> EpisodeJson(const EnvWire::FEpisodeSummary& S)
+    {
+        TSharedPtr<FJsonObject> Obj = MakeShared<FJsonObject>();
+        Obj->SetNumberField(TEXT("env"), S.EnvIndex);
+        Obj->SetNumberField(TEXT("return"), S.Return);
+        Obj->SetNumberField(TEXT("length"), S.Length);
+        Obj->SetNumberField(TEXT("hits"), S.Hits);
+        Obj->SetNumberField(TEXT("shots"), S.ShotsFired);
+        Obj->SetNumberField(TEXT("fire_blocked"), S.FireBlocked);
+        Obj->SetNumberField(TEXT("time_to_first_hit"), S.TimeToFirstHit);
+        Obj->SetNumberField(TEXT("duration"), S.Duration);
+        Obj->SetBoolField(TEXT("truncated"), S.Truncated != 0);
+        return Obj;
+    }
+}
+
+bool FEnvConnection::IsConnected() const
+{
+    if (Socket)
+        return Socket->GetConnectionState() == SCS_Connected;
+    // A Unix peer going away shows up as a failed Recv
+    return UnixFd >= 0;
+}
+
+bool FEnvConnection::Send(const uint8* Data, int32 Len, int32& Sent)
+{
+    if (Socket)
+        return Socket->Send(Data, Len, Sent);
+    return EnvEndpoint::SendSome(UnixFd, Data, Len, Sent);
+}
+
+bool FEnvConnection::Recv(uint8* Dst, int32 Len, int32& Read)
+{
+    if (Socket)
+        return Socket->Recv(Dst, Len, Read);
+    return EnvEndpoint::RecvSome(UnixFd, Dst, Len, Read);
+}
+
+bool FEnvConnection::CanWriteNow() const
+{
+    if (Socket)
+        return Socket->Wait(ESocketWaitConditions::WaitForWrite, FTimespan::Zero());
+    return EnvEndpoint::CanWriteNow(UnixFd);
+}
+
+void FEnvConnection::Shutdown()
+{
+    if (Socket)
+        Socket->Shutdown(ESocketShutdownMode::ReadWrite);
+    else
+        EnvEndpoint::ShutdownUnix(UnixFd);
+}
+
+void FEnvConnection::Close()
+{
+    if (Socket)
+    {
+        Socket->Close();
+        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+        Socket = nullptr;
+    }
+    if (UnixFd >= 0)
+    {
+        EnvEndpoint::CloseUnix(UnixFd);
+        UnixFd = -1;
+    }
+}
 
 void UTCPEnvSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
     Super::Initialize(Collection);
     bShouldStop.store(false);
+    CommandDone = FPlatformProcess::GetSynchEventFromPool(false);
+    CommandReady = FPlatformProcess::GetSynchEventFromPool(false);
+    LatencyHistograms.SetNum(EnvTelemetry::NumCommands * NumPhases);
 
     // Hook world init so we can init UE5Game when PIE/Game spawns
     FWorldDelegates::OnPostWorldInitialization.AddUObject(this, &UTCPEnvSubsystem::OnPostWorldInit);
 
+    // The command line wins over the ini, so several engine processes can run side by side
+    FString EndpointOverride;
+    if (FParse::Value(FCommandLine::Get(), TEXT("EnvEndpoint="), EndpointOverride))
+        Endpoint = EndpointOverride;
+    ListenEndpoint = EnvEndpoint::FEndpoint();
+    if (!EnvEndpoint::Parse(TCHAR_TO_ANSI(*Endpoint), ListenEndpoint))
+    {
+        UE_LOG(LogTemp, Warning, TEXT("TCPEnvSubsystem: Can't parse endpoint '%s', using the default"), *Endpoint);
+    }
+    if (ListenEndpoint.Kind == EnvEndpoint::EKind::Unix && !EnvEndpoint::SupportsUnixSockets())
+    {
+        UE_LOG(LogTemp, Warning, TEXT("TCPEnvSubsystem: No Unix domain sockets on this platform, using TCP"));
+        ListenEndpoint = EnvEndpoint::FEndpoint();
+    }
+
     // Start listening right away
     ListenerThread = std::thread(&UTCPEnvSubsystem::ListenerThreadFunc, this);
-    UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Listener thread started on port %d"), Port);
+    UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Listener thread started for %s"), *DescribeEndpoint());
 }
 
 void UTCPEnvSubsystem::Deinitialize()
@@ -32,15 +198,16 @@ void UTCPEnvSubsystem::Deinitialize()
     if (ListenSocket)
         ListenSocket->Close();
 
+    {
+        // Wake the listener if it is parked in a blocking Recv
+        FScopeLock Lock(&SendLock);
+        Client.Shutdown();
+    }
+
     if (ListenerThread.joinable())
         ListenerThread.join();
 
-    if (ClientSocket)
-    {
-        ClientSocket->Close();
-        ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(ClientSocket);
-        ClientSocket = nullptr;
-    }
+    Client.Close();
 
     if (ListenSocket)
     {
@@ -48,6 +215,37 @@ void UTCPEnvSubsystem::Deinitialize()
         ListenSocket = nullptr;
     }
 
+    if (UnixListenFd >= 0)
+    {
+        EnvEndpoint::CloseUnix(UnixListenFd, ListenEndpoint.Path);
+        UnixListenFd = -1;
+    }
+
+    ShmRing.Close();
+
+    if (bLockStep)
+        SetLockStep(false, LockStepDt, LockStepTicks, true);
+    if (TimeDilation != 1.0f)
+        SetTimeDilation(1.0f);
+
+    if (CommandDone)
+    {
+        FPlatformProcess::ReturnSynchEventToPool(CommandDone);
+        CommandDone = nullptr;
+    }
+    if (CommandReady)
+    {
+        FPlatformProcess::ReturnSynchEventToPool(CommandReady);
+        CommandReady = nullptr;
+    }
+
+    for (UUE5Game* VecEnv : VecEnvs)
+    {
+        if (VecEnv != Env)
+            VecEnv->RemoveFromRoot();
+    }
+    VecEnvs.Reset();
+
     if (Env)
     {
         Env->RemoveFromRoot();
@@ -70,176 +268,1329 @@ void UTCPEnvSubsystem::OnPostWorldInit(UWorld* World, UWorld::InitializationValu
     Env = NewObject<UUE5Game>(this);
     Env->AddToRoot();
     Env->Initialize(World);
+    EnvWorld = World;
     UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Env initialized with world '%s'"), *World->GetName());
 }
 
+ETickableTickType UTCPEnvSubsystem::GetTickableTickType() const
+{
+    return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Always;
+}
+
+TStatId UTCPEnvSubsystem::GetStatId() const
+{
+    RETURN_QUICK_DECLARE_CYCLE_STAT(UTCPEnvSubsystem, STATGROUP_Tickables);
+}
+
+void UTCPEnvSubsystem::Tick(float DeltaTime)
+{
+    if (!Env)
+        return;
+
+    // Lock-step and time dilation never outlive the trainer that asked for them
+    if (bLockStep && !bClientConnected.load())
+        SetLockStep(false, LockStepDt, LockStepTicks, true);
+    if (TimeDilation != 1.0f && !bClientConnected.load())
+        SetTimeDilation(1.0f);
+
+    // Commands run here, after the world's actors ticked, so every Step sees the same tick phase.
+    // A command that steps the sim (or one StepN tick) ends the drain for this frame.
+    while (true)
+    {
+        if (!ActiveCommand && !CommandQueue.Dequeue(ActiveCommand))
+        {
+            if (!bLockStep || bStreaming.load())
+                break;
+
+            // Lock-step: hold the game thread here so the world doesn't advance until the next request
+            if (bShouldStop.load() || !bClientConnected.load())
+                break;
+            CommandReady->Wait(50);
+            continue;
+        }
+
+        FEnvCommand* Cmd = ActiveCommand;
+        if (Cmd->ExecStartCycles == 0)
+            Cmd->ExecStartCycles = FPlatformTime::Cycles64();
+        const bool bConsumesTick = Cmd->Type == EEnvCommandType::Step || Cmd->Type == EEnvCommandType::StepN
+            || Cmd->Type == EEnvCommandType::VecStep;
+
+        if (ExecuteCommand(*Cmd))
+        {
+            Cmd->ExecEndCycles = FPlatformTime::Cycles64();
+            ActiveCommand = nullptr;
+            CompletionQueue.Enqueue(Cmd);
+            CommandDone->Trigger();
+            if (bConsumesTick && !bLockStep)
+                break;
+        }
+        else if (bConsumesTick)
+        {
+            break;
+        }
+    }
+
+    if (bStreaming.load())
+        StreamTick();
+}
+
+bool UTCPEnvSubsystem::ExecuteCommand(FEnvCommand& Cmd)
+{
+    if (Env->GetAutoReset() != Cmd.bAutoReset)
+        SetAutoReset(Cmd.bAutoReset);
+    if (Env->GetActionRepeat() != Cmd.ActionRepeat)
+        SetActionRepeat(Cmd.ActionRepeat);
+
+    switch (Cmd.Type)
+    {
+    case EEnvCommandType::Reset:
+        if (UUE5Game* Target = CommandEnv(Cmd))
+        {
+            PlanRingReply(Cmd, *Target, 1);
+            FillNextResult(Cmd, ShmRing, *Target, [Target](auto& Out) { Target->ResetInto(Out); return true; });
+        }
+        return true;
+
+    case EEnvCommandType::Sync:
+        SetLockStep(Cmd.bSyncEnable, Cmd.SyncFixedDt, Cmd.SyncTicksPerStep, Cmd.bSyncRender);
+        return true;
+
+    case EEnvCommandType::TimeDilation:
+        Cmd.TimeDilation = SetTimeDilation(Cmd.TimeDilation);
+        return true;
+
+    case EEnvCommandType::Snapshot:
+        if (UUE5Game* Target = CommandEnv(Cmd))
+        {
+            // The global RNG belongs to the game thread (Capture reseeds it), so the default seed is drawn here
+            if (!Cmd.bHasSnapshotSeed)
+            {
+                Cmd.SnapshotSeed = FMath::Rand();
+                Cmd.bHasSnapshotSeed = true;
+            }
+            Cmd.SnapshotActors = Target->CaptureSnapshot(Cmd.SnapshotSlot, Cmd.SnapshotSeed);
+            if (Cmd.bSnapshotOnReset)
+                Target->SetResetSnapshot(Cmd.SnapshotSlot);
+        }
+        return true;
+
+    case EEnvCommandType::Restore:
+        if (UUE5Game* Target = CommandEnv(Cmd))
+        {
+            PlanRingReply(Cmd, *Target, 1);
+            if (FillNextResult(Cmd, ShmRing, *Target, [&](auto& Out) { return Target->RestoreSnapshotInto(Cmd.SnapshotSlot, Out); }))
+                Cmd.SnapshotActors = 0;
+        }
+        return true;
+
+    case EEnvCommandType::Step:
+    {
+        if (bLockStep)
+            return ExecuteLockStep(Cmd);
+        UUE5Game* Target = CommandEnv(Cmd);
+        if (!Target)
+            return true;
+        // With action repeat this comes back every tick until the step is over
+        PlanRingReply(Cmd, *Target, 1);
+        const FEnvAction& A = Cmd.Actions[0];
+        return FillNextResult(Cmd, ShmRing, *Target, [&](auto& Out) { return Target->StepInto(A.Pitch, A.Yaw, A.Fire, Out); });
+    }
+
+    case EEnvCommandType::StepN:
+    {
+        if (bLockStep)
+            return ExecuteLockStep(Cmd);
+        UUE5Game* Target = CommandEnv(Cmd);
+        if (!Target)
+            return true;
+        PlanRingReply(Cmd, *Target, Cmd.Actions.Num());
+        const FEnvAction& A = Cmd.Actions[Cmd.Next];
+        if (!FillNextResult(Cmd, ShmRing, *Target, [&](auto& Out) { return Target->StepInto(A.Pitch, A.Yaw, A.Fire, Out); }))
+            return false;
+        ++Cmd.Next;
+        // With auto-reset the segment just carries on into the next episode
+        return (Cmd.bLastDone && !Cmd.bAutoReset) || Cmd.Next >= Cmd.Actions.Num();
+    }
+
+    case EEnvCommandType::VecReset:
+    case EEnvCommandType::VecStep:
+    {
+        const bool bStep = (Cmd.Type == EEnvCommandType::VecStep);
+        if (bStep && bLockStep)
+            return ExecuteLockStep(Cmd);
+        if (!bStep)
+        {
+            EnsureVecEnvs();
+            Cmd.NumEnvs = VecEnvs.Num();
+            PlanRingReply(Cmd, *Env, Cmd.NumEnvs);
+            for (UUE5Game* Instance : MakeArrayView(VecEnvs.GetData(), Cmd.NumEnvs))
+                FillNextResult(Cmd, ShmRing, *Instance, [Instance](auto& Out) { Instance->ResetInto(Out); return true; });
+            return true;
+        }
+
+        // Every instance holds its action until its own step is over; the batch replies once all are.
+        // The instances are counted on the first tick only, one spawning mid-step joins the next request.
+        if (Cmd.NumResults == 0)
+        {
+            EnsureVecEnvs();
+            Cmd.NumEnvs = VecEnvs.Num();
+            if (Cmd.Actions.Num() != Cmd.NumEnvs)
+                return true;
+
+            // Without action repeat every instance finishes on this tick, in order, so each can step
+            // straight into the next ring slot
+            if (Cmd.ActionRepeat == 1)
+                PlanRingReply(Cmd, *Env, Cmd.NumEnvs);
+            if (Cmd.bToRing)
+            {
+                for (int32 i = 0; i < Cmd.NumEnvs; ++i)
+                {
+                    const FEnvAction& A = Cmd.Actions[i];
+                    UUE5Game* Instance = VecEnvs[i];
+                    FillNextResult(Cmd, ShmRing, *Instance, [&](auto& Out) { return Instance->StepInto(A.Pitch, A.Yaw, A.Fire, Out); });
+                }
+                return true;
+            }
+
+            for (int32 i = 0; i < Cmd.NumEnvs; ++i)
+                Cmd.AddResult();
+            Cmd.RepeatingEnvs.Init(true, Cmd.NumEnvs);
+        }
+        bool bAllDone = true;
+        for (int32 i = 0; i < Cmd.NumEnvs; ++i)
+        {
+            if (!Cmd.RepeatingEnvs[i])
+                continue;
+            const FEnvAction& A = Cmd.Actions[i];
+            if (VecEnvs[i]->StepInto(A.Pitch, A.Yaw, A.Fire, Cmd.Results[i]))
+                Cmd.RepeatingEnvs[i] = false;
+            else
+                bAllDone = false;
+        }
+        return bAllDone;
+    }
+
+    case EEnvCommandType::EpisodeStats:
+        // VecEnvs starts with Env, so this covers the local player's instance too
+        EnsureVecEnvs();
+        for (UUE5Game* Instance : VecEnvs)
+            Cmd.EpisodesDropped += Instance->DrainEpisodeStats(Cmd.Episodes);
+        return true;
+
+    case EEnvCommandType::Pause:
+    case EEnvCommandType::Resume:
+        for (auto& Ctx : GEngine->GetWorldContexts())
+            if (UWorld* W = Ctx.World())
+                UGameplayStatics::SetGamePaused(W, Cmd.Type == EEnvCommandType::Pause);
+        return true;
+
+    case EEnvCommandType::Stream:
+    {
+        // Tick ids restart with every stream so the client can line them up from 1
+        FScopeLock Lock(&StreamActionLock);
+        PendingStreamTick = 0;
+        SupersededActions = 0;
+        StreamTickId = 0;
+        LastAppliedActionTick = 0;
+        SkippedStreamFrames = 0;
+        bStreaming.store(Cmd.bStreamEnable);
+        return true;
+    }
+    }
+    return true;
+}
+
+bool UTCPEnvSubsystem::ExecuteLockStep(FEnvCommand& Cmd)
+{
+    // Still advancing the world for the action applied earlier
+    if (Cmd.TicksLeft > 0 && --Cmd.TicksLeft > 0)
+        return false;
+
+    const bool bVec = (Cmd.Type == EEnvCommandType::VecStep);
+    UUE5Game* Target = bVec ? nullptr : CommandEnv(Cmd);
+    if (!bVec && !Target)
+        return true;
+    // Each fixed tick advances the world by LockStepDt scaled by the dilation
+    const float StepDt = LockStepDt * LockStepTicks * TimeDilation;
+
+    if (Cmd.bApplied)
+    {
+        // Action repeat: another k ticks with the same action wherever the step isn't over yet
+        if (ReapplyLockStepAction(Cmd, Target))
+        {
+            Cmd.TicksLeft = LockStepTicks;
+            return false;
+        }
+
+        // k ticks have run since the action last went in: read the results back
+        auto Collect = [StepDt](UUE5Game* Instance)
+        {
+            return [Instance, StepDt](auto& Out)
+            {
+                Instance->CollectResultInto(Out);
+                Out.DeltaTime = StepDt * Instance->GetLastStepRepeats();
+                return true;
+            };
+        };
+        if (bVec)
+        {
+            PlanRingReply(Cmd, *Env, Cmd.NumEnvs);
+            for (UUE5Game* Instance : MakeArrayView(VecEnvs.GetData(), Cmd.NumEnvs))
+                FillNextResult(Cmd, ShmRing, *Instance, Collect(Instance));
+            return true;
+        }
+
+        PlanRingReply(Cmd, *Target, Cmd.Actions.Num());
+        FillNextResult(Cmd, ShmRing, *Target, Collect(Target));
+        Cmd.bApplied = false;
+        if (Cmd.Type == EEnvCommandType::Step || (Cmd.bLastDone && !Cmd.bAutoReset) || Cmd.Next >= Cmd.Actions.Num())
+            return true;
+    }
+
+    if (bVec)
+    {
+        EnsureVecEnvs();
+        Cmd.NumEnvs = VecEnvs.Num();
+        if (Cmd.Actions.Num() != Cmd.NumEnvs)
+            return true;
+        Cmd.RepeatingEnvs.Init(false, Cmd.NumEnvs);
+        for (int32 i = 0; i < Cmd.NumEnvs; ++i)
+            Cmd.RepeatingEnvs[i] = !VecEnvs[i]->ApplyRepeatedAction(Cmd.Actions[i].Pitch, Cmd.Actions[i].Yaw, Cmd.Actions[i].Fire);
+    }
+    else
+    {
+        const FEnvAction& A = Cmd.Actions[Cmd.Next++];
+        Cmd.RepeatingEnvs.Init(!Target->ApplyRepeatedAction(A.Pitch, A.Yaw, A.Fire), 1);
+    }
+
+    Cmd.bApplied = true;
+    Cmd.TicksLeft = LockStepTicks;
+    return false;
+}
+
+void UTCPEnvSubsystem::SetLockStep(bool bEnable, float FixedDt, int32 TicksPerStep, bool bRender)
+{
+    if (bEnable && !bLockStep)
+    {
+        bPrevUseFixedTimeStep = FApp::UseFixedTimeStep();
+        PrevFixedDeltaTime = FApp::GetFixedDeltaTime();
+    }
+
+    if (bEnable)
+    {
+        // Fixed dt with no frame-rate wait: the engine runs as fast as the CPU allows
+        LockStepDt = FixedDt;
+        LockStepTicks = TicksPerStep;
+        FApp::SetUseFixedTimeStep(true);
+        FApp::SetFixedDeltaTime(FixedDt);
+    }
+    else if (bLockStep)
+    {
+        FApp::SetUseFixedTimeStep(bPrevUseFixedTimeStep);
+        FApp::SetFixedDeltaTime(PrevFixedDeltaTime);
+    }
+
+    if (GEngine && GEngine->GameViewport)
+        GEngine->GameViewport->bDisableWorldRendering = bEnable && !bRender;
+
+    bLockStep = bEnable;
+    UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Lock-step %s (dt=%.4f, ticks/step=%d, render=%s)"),
+        bEnable ? TEXT("on") : TEXT("off"), LockStepDt, LockStepTicks, bRender ? TEXT("on") : TEXT("off"));
+}
+
+float UTCPEnvSubsystem::SetTimeDilation(float Dilation)
+{
+    UWorld* World = EnvWorld.Get();
+    if (!World)
+        return TimeDilation;
+
+    // The world settings clamp to their Min/MaxGlobalTimeDilation, so report what was applied
+    UGameplayStatics::SetGlobalTimeDilation(World, Dilation);
+    TimeDilation = UGameplayStatics::GetGlobalTimeDilation(World);
+    UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Time dilation %.2f (asked for %.2f)"), TimeDilation, Dilation);
+    return TimeDilation;
+}
+
+void UTCPEnvSubsystem::StreamTick()
+{
+    // Runs after the world ticked, so this observation shows the action applied on the previous tick
+    FStepResult& SR = StreamResult;
+    Env->CollectResultInto(SR);
+
+    EnvWire::FStreamInfo Info = {};
+    Info.Tick = ++StreamTickId;
+    Info.ActionTick = LastAppliedActionTick;
+    Info.SkippedFrames = SkippedStreamFrames;
+
+    // Only the newest action is applied; older ones that never got a tick are just counted
+    FEnvAction Action;
+    uint64 ActionTick = 0;
+    {
+        FScopeLock Lock(&StreamActionLock);
+        Action = PendingStreamAction;
+        ActionTick = PendingStreamTick;
+        Info.Superseded = SupersededActions;
+        PendingStreamTick = 0;
+        SupersededActions = 0;
+    }
+    if (ActionTick != 0)
+        Env->ApplyAction(Action.Pitch, Action.Yaw, Action.Fire);
+    LastAppliedActionTick = ActionTick;
+
+    SkippedStreamFrames = SendStreamFrame(SR, Info) ? 0 : SkippedStreamFrames + 1;
+}
+
+bool UTCPEnvSubsystem::SendStreamFrame(const FStepResult& SR, const EnvWire::FStreamInfo& Info)
+{
+    // Always a binary frame, whatever the replies use; shm is left out since the client may lag the ring
+    StreamBuffer.SetNumUninitialized(EnvWire::LengthPrefixSize + sizeof(EnvWire::FFrameHeader) + sizeof(EnvWire::FStreamInfo) + RecordMaxSize(SR), EAllowShrinking::No);
+
+    uint8* Payload = StreamBuffer.GetData() + EnvWire::LengthPrefixSize;
+    const uint16 Flags = (bPackedGrid ? EnvWire::FlagPackedGrid : 0) | (bAutoReset ? EnvWire::FlagAutoReset : 0) |
+        (bEpisodeStats ? EnvWire::FlagEpisodeStats : 0);
+    uint8* Cursor = EnvWire::WriteFrameHeader(Payload, EnvWire::EFrameKind::Stream, Flags, 1);
+    FMemory::Memcpy(Cursor, &Info, sizeof(Info));
+    Cursor = WriteRecord(Cursor + sizeof(Info), SR);
+    const int32 PayloadLen = static_cast<int32>(Cursor - Payload);
+    EnvWire::WriteLengthPrefix(StreamBuffer.GetData(), static_cast<uint32>(PayloadLen));
+
+    // A client that stops reading must not stall the sim, so skip the frame instead of blocking
+    FScopeLock Lock(&SendLock);
+    if (!Client.IsOpen() || !bStreaming.load() || !Client.CanWriteNow())
+        return false;
+    return SendAll(Client, StreamBuffer.GetData(), EnvWire::LengthPrefixSize + PayloadLen);
+}
+
+bool UTCPEnvSubsystem::RunOnGameThread()
+{
+    Command.bAutoReset = bAutoReset;
+    Command.ActionRepeat = ActionRepeat;
+    Command.bRingAllowed = Encoding == EEnvEncoding::SharedMemory && ShmRing.IsOpen();
+    Timing.Enqueued = FPlatformTime::Cycles64();
+    CommandQueue.Enqueue(&Command);
+    CommandReady->Trigger();
+
+    FEnvCommand* Completed = nullptr;
+    while (!CompletionQueue.Dequeue(Completed))
+    {
+        // Time out now and then so shutdown never leaves us parked on the event
+        if (bShouldStop.load())
+            return false;
+        CommandDone->Wait(100);
+    }
+    Timing.Completed = FPlatformTime::Cycles64();
+    return true;
+}
+
 void UTCPEnvSubsystem::ListenerThreadFunc()
 {
     ISocketSubsystem* Subsys = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
-    ListenSocket = Subsys->CreateSocket(NAME_Stream, TEXT("EnvListener"), false);
-    ListenSocket->SetReuseAddr(true);
-    ListenSocket->SetNonBlocking(true);
+    if (ListenEndpoint.Kind == EnvEndpoint::EKind::Unix)
+    {
+        // Same framing, just no TCP/IP stack in between
+        UnixListenFd = EnvEndpoint::ListenUnix(ListenEndpoint.Path);
+        if (UnixListenFd < 0)
+        {
+            UE_LOG(LogTemp, Error, TEXT("TCPEnvSubsystem: Failed to bind/listen on %s"), *DescribeEndpoint());
+            return;
+        }
+    }
+    else
+    {
+        ListenSocket = Subsys->CreateSocket(NAME_Stream, TEXT("EnvListener"), false);
+        ListenSocket->SetReuseAddr(true);
+        ListenSocket->SetNonBlocking(true);
 
-    TSharedRef<FInternetAddr> Addr = Subsys->CreateInternetAddr();
-    bool bValid = false;
-    Addr->SetIp(TEXT("127.0.0.1"), bValid);
-    Addr->SetPort(Port);
+        TSharedRef<FInternetAddr> Addr = Subsys->CreateInternetAddr();
+        bool bValid = false;
+        Addr->SetIp(ANSI_TO_TCHAR(ListenEndpoint.Host), bValid);
+        Addr->SetPort(ListenEndpoint.Port);
 
-    if (!bValid || !ListenSocket->Bind(*Addr) || !ListenSocket->Listen(1))
-    {
-        UE_LOG(LogTemp, Error, TEXT("TCPEnvSubsystem: Failed to bind/listen on port %d"), Port);
-        return;
+        if (!bValid || !ListenSocket->Bind(*Addr) || !ListenSocket->Listen(1))
+        {
+            UE_LOG(LogTemp, Error, TEXT("TCPEnvSubsystem: Failed to bind/listen on %s"), *DescribeEndpoint());
+            return;
+        }
     }
 
-    UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Listening on 127.0.0.1:%d"), Port);
+    UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Listening on %s"), *DescribeEndpoint());
 
     TSharedPtr<FInternetAddr> ClientAddr = Subsys->CreateInternetAddr();
 
     while (!bShouldStop.load())
     {
         // wait for a client
-        while (!bShouldStop.load() && ClientSocket == nullptr)
+        while (!bShouldStop.load() && !Client.IsOpen())
         {
-            bool bPending = false;
-            if (ListenSocket->HasPendingConnection(bPending) && bPending)
+            if (UnixListenFd >= 0)
             {
-                ClientSocket = ListenSocket->Accept(*ClientAddr, TEXT("EnvClient"));
-                if (ClientSocket)
+                Client.UnixFd = EnvEndpoint::AcceptUnix(UnixListenFd);
+            }
+            else
+            {
+                bool bPending = false;
+                if (ListenSocket->HasPendingConnection(bPending) && bPending)
                 {
-                    ClientSocket->SetNonBlocking(false);
-                    UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Client connected"));
-                    break;
+                    Client.Socket = ListenSocket->Accept(*ClientAddr, TEXT("EnvClient"));
+                    if (Client.Socket)
+                    {
+                        Client.Socket->SetNonBlocking(false);
+                        // Replies are small and latency bound, don't let Nagle hold them back
+                        Client.Socket->SetNoDelay(true);
+                    }
                 }
             }
+
+            if (Client.IsOpen())
+            {
+                bClientConnected.store(true);
+                UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Client connected"));
+                break;
+            }
             FPlatformProcess::Sleep(0.01f);
         }
 
         // serve until disconnect
-        while (!bShouldStop.load() && ClientSocket && ClientSocket->GetConnectionState() == SCS_Connected)
+        while (!bShouldStop.load() && Client.IsConnected())
         {
-            TSharedPtr<FJsonObject> Req = ReceiveJson(ClientSocket);
+            TSharedPtr<FJsonObject> Req = ReceiveJson(Client);
             if (!Req) break;
 
+            Timing.Parsed = FPlatformTime::Cycles64();
             FString Cmd = Req->GetStringField(TEXT("cmd"));
             TSharedPtr<FJsonObject> Resp = MakeShared<FJsonObject>();
+            bool bReplied = false;
 
-            if (Cmd == TEXT("reset"))
+            if (Cmd == TEXT("hello"))
             {
-                FEvent* Sync = FPlatformProcess::GetSynchEventFromPool(true);
-                FStepResult SR;
-                AsyncTask(ENamedThreads::GameThread, [this, &SR, Sync]()
+                // Encoding negotiation; anything we don't recognise stays on JSON
+                FString Requested;
+                Req->TryGetStringField(TEXT("encoding"), Requested);
+                Encoding = (Requested == TEXT("binary") || Requested == TEXT("shm")) ? EEnvEncoding::Binary : EEnvEncoding::Json;
+
+                if (Requested == TEXT("shm"))
+                {
+                    // Falls back to plain binary frames if the OS won't give us the mapping
+                    int32 Slots = EnvShm::DefaultSlotCount;
+                    int32 ObsCapacity = EnvShm::DefaultObsCapacity;
+                    Req->TryGetNumberField(TEXT("slots"), Slots);
+                    Req->TryGetNumberField(TEXT("obs_capacity"), ObsCapacity);
+                    // Unique per listener, so engines running side by side don't share a ring
+                    const FString ShmName = ListenEndpoint.Kind == EnvEndpoint::EKind::Unix
+                        ? FString::Printf(TEXT("steelrain_env_p%u"), FPlatformProcess::GetCurrentProcessId())
+                        : FString::Printf(TEXT("steelrain_env_%d"), ListenEndpoint.Port);
+                    if (ShmRing.Create(TCHAR_TO_ANSI(*ShmName), static_cast<uint32>(FMath::Max(Slots, 0)), static_cast<uint32>(FMath::Max(ObsCapacity, 0))))
+                    {
+                        Encoding = EEnvEncoding::SharedMemory;
+                        Resp->SetStringField(TEXT("shm_name"), ShmName);
+                        Resp->SetNumberField(TEXT("slots"), ShmRing.GetSlotCount());
+                        Resp->SetNumberField(TEXT("obs_capacity"), ShmRing.GetObsCapacity());
+                    }
+                    else
                     {
-                        SR = Env->Reset();
-                        Sync->Trigger();
-                    });
-                Sync->Wait();
-                FPlatformProcess::ReturnSynchEventToPool(Sync);
-
-                TArray<TSharedPtr<FJsonValue>> Arr;
-                for (float v : SR.Obs) Arr.Add(MakeShared<FJsonValueNumber>(v));
-                Resp->SetArrayField(TEXT("obs"), Arr);
-                Resp->SetNumberField(TEXT("reward"), SR.Reward);
-                Resp->SetBoolField(TEXT("done"), SR.Done);
-                Resp->SetNumberField(TEXT("delta_time"), SR.DeltaTime);
-            }
-            else if (Cmd == TEXT("step"))
-            {
-                auto& JA = Req->GetArrayField(TEXT("action"));
-                float p = JA[0]->AsNumber();
-                float y = JA[1]->AsNumber();
-                int32 f = static_cast<int32>(JA[2]->AsNumber());
-
-                FEvent* Sync = FPlatformProcess::GetSynchEventFromPool(true);
-                FStepResult SR;
-                AsyncTask(ENamedThreads::GameThread, [this, p, y, f, &SR, Sync]()
+                        UE_LOG(LogTemp, Warning, TEXT("TCPEnvSubsystem: Could not map shared memory '%s', using binary frames"), *ShmName);
+                    }
+                }
+
+                Resp->SetStringField(TEXT("status"), TEXT("ok"));
+                Resp->SetStringField(TEXT("encoding"),
+                    Encoding == EEnvEncoding::SharedMemory ? TEXT("shm") :
+                    Encoding == EEnvEncoding::Binary ? TEXT("binary") : TEXT("json"));
+                Resp->SetNumberField(TEXT("version"), EnvWire::Version);
+
+                // Grid packing only applies to binary frames
+                FString ObsEncoding;
+                Req->TryGetStringField(TEXT("obs_encoding"), ObsEncoding);
+                bPackedGrid = Encoding != EEnvEncoding::Json && ObsEncoding == TEXT("packed");
+                Resp->SetStringField(TEXT("obs_encoding"), bPackedGrid ? TEXT("packed") : TEXT("float"));
+
+                bTimingBlock = false;
+                Req->TryGetBoolField(TEXT("timing"), bTimingBlock);
+                Resp->SetBoolField(TEXT("timing"), bTimingBlock);
+
+                // Takes effect on the game thread with the next command
+                bAutoReset = false;
+                Req->TryGetBoolField(TEXT("auto_reset"), bAutoReset);
+                Resp->SetBoolField(TEXT("auto_reset"), bAutoReset);
+
+                // Frame-skip: every step holds its action for this many ticks, also takes effect with the next command
+                ActionRepeat = 1;
+                Req->TryGetNumberField(TEXT("action_repeat"), ActionRepeat);
+                ActionRepeat = FMath::Clamp(ActionRepeat, 1, 1000);
+                Resp->SetNumberField(TEXT("action_repeat"), ActionRepeat);
+
+                // Summaries only ride along on replies, shm records would have nowhere to put them
+                bEpisodeStats = false;
+                Req->TryGetBoolField(TEXT("episode_stats"), bEpisodeStats);
+                bEpisodeStats = bEpisodeStats && Encoding != EEnvEncoding::SharedMemory;
+                Resp->SetBoolField(TEXT("episode_stats"), bEpisodeStats);
+
+                // For trainers on another machine; batched binary frames only
+                FString Compression;
+                Req->TryGetStringField(TEXT("compression"), Compression);
+                CompressionCodec = (Encoding != EEnvEncoding::Json && Compression == TEXT("zlib")) ? EnvWire::ECodec::Zlib : EnvWire::ECodec::None;
+                int32 Threshold = static_cast<int32>(EnvWire::DefaultCompressThreshold);
+                Req->TryGetNumberField(TEXT("compress_threshold"), Threshold);
+                CompressThreshold = static_cast<uint32>(FMath::Max(Threshold, 0));
+                Resp->SetStringField(TEXT("compression"), CompressionCodec == EnvWire::ECodec::Zlib ? TEXT("zlib") : TEXT("none"));
+                Resp->SetNumberField(TEXT("compress_threshold"), CompressThreshold);
+            }
+            else if (Cmd == TEXT("reset") || Cmd == TEXT("step"))
+            {
+                // Optional "env": k drives instance "Env<k>" instead of the local player's turret
+                const bool bStep = (Cmd == TEXT("step"));
+                Command.Reset(bStep ? EEnvCommandType::Step : EEnvCommandType::Reset);
+                Req->TryGetNumberField(TEXT("env"), Command.EnvIndex);
+                if (bStep)
+                    Command.Actions.Add(ParseAction(Req->GetArrayField(TEXT("action"))));
+                if (!RunOnGameThread()) break;
+
+                if (Command.bNoSuchEnv)
+                {
+                    SetNoSuchEnv(Resp, Command);
+                }
+                else
+                {
+                    SendCommandResults(Client, Command, EnvWire::EFrameKind::Step);
+                    bReplied = true;
+                }
+            }
+            else if (Cmd == TEXT("step_n"))
+            {
+                // Either "actions": [[p,y,f], ...] or "action": [p,y,f] plus "repeat": N
+                Command.Reset(EEnvCommandType::StepN);
+                Req->TryGetNumberField(TEXT("env"), Command.EnvIndex);
+                const TArray<TSharedPtr<FJsonValue>>* ActionList = nullptr;
+                if (Req->TryGetArrayField(TEXT("actions"), ActionList))
+                {
+                    for (const TSharedPtr<FJsonValue>& V : *ActionList)
+                        Command.Actions.Add(ParseAction(V->AsArray()));
+                }
+                else
+                {
+                    const FEnvAction A = ParseAction(Req->GetArrayField(TEXT("action")));
+                    int32 Repeat = 1;
+                    Req->TryGetNumberField(TEXT("repeat"), Repeat);
+                    Command.Actions.Init(A, FMath::Clamp(Repeat, 1, MaxStepsPerRequest));
+                }
+                if (Command.Actions.Num() > MaxStepsPerRequest)
+                    Command.Actions.SetNum(MaxStepsPerRequest);
+
+                if (Command.Actions.Num() > 0 && !RunOnGameThread()) break;
+
+                if (Command.bNoSuchEnv)
+                {
+                    SetNoSuchEnv(Resp, Command);
+                }
+                else
+                {
+                    SendCommandResults(Client, Command, EnvWire::EFrameKind::Trajectory);
+                    bReplied = true;
+                }
+            }
+            else if (Cmd == TEXT("vec_reset") || Cmd == TEXT("vec_step"))
+            {
+                // vec_step takes "actions": [[p,y,f], ...] with exactly one row per env instance
+                const bool bStep = (Cmd == TEXT("vec_step"));
+                Command.Reset(bStep ? EEnvCommandType::VecStep : EEnvCommandType::VecReset);
+                const TArray<TSharedPtr<FJsonValue>>* ActionList = nullptr;
+                if (bStep && Req->TryGetArrayField(TEXT("actions"), ActionList))
+                {
+                    for (const TSharedPtr<FJsonValue>& V : *ActionList)
+                        Command.Actions.Add(ParseAction(V->AsArray()));
+                }
+                if (!RunOnGameThread()) break;
+
+                if (bStep && Command.Actions.Num() != Command.NumEnvs)
+                {
+                    UE_LOG(LogTemp, Warning, TEXT("TCPEnvSubsystem: vec_step got %d actions for %d envs"), Command.Actions.Num(), Command.NumEnvs);
+                    Resp->SetStringField(TEXT("status"), TEXT("error"));
+                    Resp->SetNumberField(TEXT("num_envs"), Command.NumEnvs);
+                    SendJson(Client, Resp);
+                }
+                else
+                {
+                    SendCommandResults(Client, Command, EnvWire::EFrameKind::Batch);
+                }
+                bReplied = true;
+            }
+            else if (Cmd == TEXT("sync"))
+            {
+                // {"enabled": bool, "fixed_dt": s, "ticks_per_step": k, "render": bool}
+                Command.Reset(EEnvCommandType::Sync);
+                Command.bSyncEnable = true;
+                Command.bSyncRender = true;
+                double FixedDt = 1.0 / 60.0;
+                int32 TicksPerStep = 1;
+                Req->TryGetBoolField(TEXT("enabled"), Command.bSyncEnable);
+                Req->TryGetBoolField(TEXT("render"), Command.bSyncRender);
+                Req->TryGetNumberField(TEXT("fixed_dt"), FixedDt);
+                Req->TryGetNumberField(TEXT("ticks_per_step"), TicksPerStep);
+                Command.SyncFixedDt = FMath::Clamp(static_cast<float>(FixedDt), 1e-4f, 1.0f);
+                Command.SyncTicksPerStep = FMath::Clamp(TicksPerStep, 1, MaxStepsPerRequest);
+                if (!RunOnGameThread()) break;
+
+                Resp->SetStringField(TEXT("status"), TEXT("ok"));
+                Resp->SetBoolField(TEXT("sync"), Command.bSyncEnable);
+                Resp->SetNumberField(TEXT("fixed_dt"), Command.SyncFixedDt);
+                Resp->SetNumberField(TEXT("ticks_per_step"), Command.SyncTicksPerStep);
+            }
+            else if (Cmd == TEXT("set_time_dilation"))
+            {
+                // {"dilation": x}; sim seconds per real second, the dynamics per sim second stay the same
+                Command.Reset(EEnvCommandType::TimeDilation);
+                double Dilation = 1.0;
+                Req->TryGetNumberField(TEXT("dilation"), Dilation);
+                Command.TimeDilation = FMath::Max(static_cast<float>(Dilation), 1e-4f);
+                if (!RunOnGameThread()) break;
+
+                Resp->SetStringField(TEXT("status"), TEXT("ok"));
+                Resp->SetNumberField(TEXT("time_dilation"), Command.TimeDilation);
+            }
+            else if (Cmd == TEXT("snapshot") || Cmd == TEXT("restore"))
+            {
+                // snapshot: {"slot": k, "seed": s, "env": i, "on_reset": bool}, restore: {"slot": k, "env": i}
+                const bool bCapture = (Cmd == TEXT("snapshot"));
+                Command.Reset(bCapture ? EEnvCommandType::Snapshot : EEnvCommandType::Restore);
+                Command.SnapshotSlot = 0;
+                Command.SnapshotSeed = 0;
+                Command.bSnapshotOnReset = false;
+                Command.SnapshotActors = -1;
+                Req->TryGetNumberField(TEXT("env"), Command.EnvIndex);
+                Req->TryGetNumberField(TEXT("slot"), Command.SnapshotSlot);
+                Command.bHasSnapshotSeed = Req->TryGetNumberField(TEXT("seed"), Command.SnapshotSeed);
+                Req->TryGetBoolField(TEXT("on_reset"), Command.bSnapshotOnReset);
+                if (Command.SnapshotSlot >= 0 && !RunOnGameThread()) break;
+
+                if (!bCapture && Command.NumResults > 0)
+                {
+                    // Same reply as a reset, so the client gets the restored observation right away
+                    SendCommandResults(Client, Command, EnvWire::EFrameKind::Step);
+                    bReplied = true;
+                }
+                else
+                {
+                    Resp->SetStringField(TEXT("status"), Command.SnapshotActors >= 0 ? TEXT("ok") : TEXT("error"));
+                    Resp->SetNumberField(TEXT("slot"), Command.SnapshotSlot);
+                    if (Command.bNoSuchEnv)
+                        SetNoSuchEnv(Resp, Command);
+                    if (bCapture && Command.SnapshotActors >= 0)
                     {
-                        SR = Env->Step(p, y, f);
-                        Sync->Trigger();
-                    });
-                Sync->Wait();
-                FPlatformProcess::ReturnSynchEventToPool(Sync);
-
-                TArray<TSharedPtr<FJsonValue>> Arr;
-                for (float v : SR.Obs) Arr.Add(MakeShared<FJsonValueNumber>(v));
-                Resp->SetArrayField(TEXT("obs"), Arr);
-                Resp->SetNumberField(TEXT("reward"), SR.Reward);
-                Resp->SetBoolField(TEXT("done"), SR.Done);
-                Resp->SetNumberField(TEXT("delta_time"), SR.DeltaTime);
+                        Resp->SetNumberField(TEXT("actors"), Command.SnapshotActors);
+                        Resp->SetNumberField(TEXT("seed"), Command.SnapshotSeed);
+                    }
+                }
+            }
+            else if (Cmd == TEXT("episode_stats"))
+            {
+                // Every episode finished since the last call, across all instances
+                Command.Reset(EEnvCommandType::EpisodeStats);
+                Command.Episodes.Reset();
+                Command.EpisodesDropped = 0;
+                if (!RunOnGameThread()) break;
+
+                TArray<TSharedPtr<FJsonValue>> Episodes;
+                for (const EnvWire::FEpisodeSummary& S : Command.Episodes)
+                    Episodes.Add(MakeShared<FJsonValueObject>(EpisodeJson(S)));
+                Resp->SetStringField(TEXT("status"), TEXT("ok"));
+                Resp->SetArrayField(TEXT("episodes"), Episodes);
+                Resp->SetNumberField(TEXT("dropped"), static_cast<double>(Command.EpisodesDropped));
+            }
+            else if (Cmd == TEXT("stats"))
+            {
+                Resp->SetStringField(TEXT("status"), TEXT("ok"));
+                Resp->SetObjectField(TEXT("stats"), BuildStatsJson());
+
+                bool bResetStats = false;
+                Req->TryGetBoolField(TEXT("reset"), bResetStats);
+                if (bResetStats)
+                {
+                    for (EnvTelemetry::FLatencyHistogram& H : LatencyHistograms)
+                        H.Reset();
+                }
+            }
+            else if (Cmd == TEXT("stream"))
+            {
+                // {"enabled": bool}; while on, every tick pushes a Stream frame and actions come in via "act"
+                Command.Reset(EEnvCommandType::Stream);
+                Command.bStreamEnable = true;
+                Req->TryGetBoolField(TEXT("enabled"), Command.bStreamEnable);
+                if (!RunOnGameThread()) break;
+
+                Resp->SetStringField(TEXT("status"), TEXT("ok"));
+                Resp->SetBoolField(TEXT("stream"), Command.bStreamEnable);
+            }
+            else if (Cmd == TEXT("act"))
+            {
+                // {"tick": id, "action": [p,y,f]} where id is the Stream frame the action answers. No reply
+                double ActionTick = 1.0;
+                Req->TryGetNumberField(TEXT("tick"), ActionTick);
+                const FEnvAction A = ParseAction(Req->GetArrayField(TEXT("action")));
+                {
+                    FScopeLock Lock(&StreamActionLock);
+                    if (PendingStreamTick != 0)
+                        ++SupersededActions;
+                    PendingStreamAction = A;
+                    PendingStreamTick = FMath::Max<uint64>(static_cast<uint64>(FMath::Max(ActionTick, 0.0)), 1);
+                }
+                continue;
             }
             else if (Cmd == TEXT("pause") || Cmd == TEXT("resume"))
             {
                 bool bPause = (Cmd == TEXT("pause"));
-                FEvent* Sync = FPlatformProcess::GetSynchEventFromPool(true);
-                AsyncTask(ENamedThreads::GameThread, [bPause, Sync]()
-                    {
-                        for (auto& Ctx : GEngine->GetWorldContexts())
-                            if (UWorld* W = Ctx.World())
-                                UGameplayStatics::SetGamePaused(W, bPause);
-                        Sync->Trigger();
-                    });
-                Sync->Wait();
-                FPlatformProcess::ReturnSynchEventToPool(Sync);
+                Command.Reset(bPause ? EEnvCommandType::Pause : EEnvCommandType::Resume);
+                if (!RunOnGameThread()) break;
 
                 Resp->SetStringField(TEXT("status"), bPause ? TEXT("paused") : TEXT("resumed"));
             }
 
-            SendJson(ClientSocket, Resp);
+            if (!bReplied)
+                SendJson(Client, Resp);
+            RecordRequestTiming(Cmd);
         }
 
         // clean up
-        if (ClientSocket)
+        bClientConnected.store(false);
+        bStreaming.store(false);
+        Encoding = EEnvEncoding::Json;
+        bPackedGrid = false;
+        bTimingBlock = false;
+        bAutoReset = false;
+        ActionRepeat = 1;
+        bEpisodeStats = false;
+        CompressionCodec = EnvWire::ECodec::None;
+        ShmRing.Close();
+        if (Client.IsOpen())
         {
-            ClientSocket->Close();
-            Subsys->DestroySocket(ClientSocket);
-            ClientSocket = nullptr;
+            // The game thread may be halfway through a stream frame
+            FScopeLock Lock(&SendLock);
+            Client.Close();
             UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Client disconnected"));
         }
     }
 }
 
-bool UTCPEnvSubsystem::SendJson(FSocket* Socket, const TSharedPtr<FJsonObject>& JsonObj)
+bool UTCPEnvSubsystem::SendJson(FEnvConnection& Conn, const TSharedPtr<FJsonObject>& JsonObj)
 {
-    // Serialize JSON
-    FString Out;
-    TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Out);
+    if (Timing.EncodeStart == 0)
+        Timing.EncodeStart = FPlatformTime::Cycles64();
+
+    if (bTimingBlock)
+    {
+        const EnvWire::FTimingBlock T = MakeTimingBlock();
+        TSharedPtr<FJsonObject> TimingObj = MakeShared<FJsonObject>();
+        TimingObj->SetNumberField(TEXT("recv_us"), T.RecvUs);
+        TimingObj->SetNumberField(TEXT("queue_us"), T.QueueUs);
+        TimingObj->SetNumberField(TEXT("execute_us"), T.ExecuteUs);
+        TimingObj->SetNumberField(TEXT("wake_us"), T.WakeUs);
+        TimingObj->SetNumberField(TEXT("prev_encode_us"), T.PrevEncodeUs);
+        TimingObj->SetNumberField(TEXT("prev_send_us"), T.PrevSendUs);
+        JsonObj->SetObjectField(TEXT("timing"), TimingObj);
+    }
+
+    // Serialize straight to UTF-8 behind a reserved length prefix, no FString round trip
+    JsonSendBuffer.SetNumUninitialized(EnvWire::LengthPrefixSize, EAllowShrinking::No);
+    FMemoryWriter Ar(JsonSendBuffer);
+    Ar.Seek(EnvWire::LengthPrefixSize);
+    TSharedRef<TJsonWriter<UTF8CHAR, TCondensedJsonPrintPolicy<UTF8CHAR>>> Writer =
+        TJsonWriterFactory<UTF8CHAR, TCondensedJsonPrintPolicy<UTF8CHAR>>::Create(&Ar);
     FJsonSerializer::Serialize(JsonObj.ToSharedRef(), Writer);
-    FTCHARToUTF8 Converter(*Out);
 
-    // Little-endian length header to match Python struct.pack('<I', )
-    uint32_t Len = Converter.Length();
-    int32 Sent = 0;
-    Socket->Send(reinterpret_cast<const uint8*>(&Len), sizeof(Len), Sent);
+    return SendFrame(Conn, JsonSendBuffer.GetData(), JsonSendBuffer.Num() - EnvWire::LengthPrefixSize);
+}
+
+bool UTCPEnvSubsystem::SendStepResult(FEnvConnection& Conn, const FStepResult& SR)
+{
+    Timing.EncodeStart = FPlatformTime::Cycles64();
+
+    if (Encoding == EEnvEncoding::Json)
+    {
+        TSharedPtr<FJsonObject> Resp = MakeShared<FJsonObject>();
+        TArray<TSharedPtr<FJsonValue>> Arr;
+        for (float v : SR.Obs) Arr.Add(MakeShared<FJsonValueNumber>(v));
+        Resp->SetArrayField(TEXT("obs"), Arr);
+        Resp->SetNumberField(TEXT("reward"), SR.Reward);
+        Resp->SetBoolField(TEXT("done"), SR.Done);
+        Resp->SetNumberField(TEXT("delta_time"), SR.DeltaTime);
+        if (bAutoReset && SR.Done)
+        {
+            TArray<TSharedPtr<FJsonValue>> ResetArr;
+            for (float v : SR.ResetObs) ResetArr.Add(MakeShared<FJsonValueNumber>(v));
+            Resp->SetArrayField(TEXT("reset_obs"), ResetArr);
+        }
+        if (bEpisodeStats && SR.Done)
+            Resp->SetObjectField(TEXT("episode"), EpisodeJson(SR.Episode));
+        return SendJson(Conn, Resp);
+    }
+
+    if (Encoding == EEnvEncoding::SharedMemory && FitsRing(&SR, 1))
+        return SendViaRing(Conn, &SR, 1, EnvWire::EFrameKind::Step);
+
+    // Binary: frame header + one step record + raw float32 (or packed) obs
+    FrameBuffer.SetNumUninitialized(EnvWire::LengthPrefixSize + sizeof(EnvWire::FFrameHeader) + sizeof(EnvWire::FTimingBlock) + RecordMaxSize(SR), EAllowShrinking::No);
+
+    uint8* Payload = FrameBuffer.GetData() + EnvWire::LengthPrefixSize;
+    uint8* Cursor = EnvWire::WriteFrameHeader(Payload, EnvWire::EFrameKind::Step, FrameFlags(), 1);
+    Cursor = WriteTimingBlock(Cursor);
+    Cursor = WriteRecord(Cursor, SR);
+
+    return SendFrame(Conn, FrameBuffer.GetData(), static_cast<int32>(Cursor - Payload));
+}
+
+bool UTCPEnvSubsystem::SendResultBatch(FEnvConnection& Conn, const FStepResult* Results, int32 Num, EnvWire::EFrameKind Kind)
+{
+    Timing.EncodeStart = FPlatformTime::Cycles64();
+
+    if (Encoding == EEnvEncoding::Json)
+    {
+        TSharedPtr<FJsonObject> Resp = MakeShared<FJsonObject>();
+        TArray<TSharedPtr<FJsonValue>> ObsRows, Rewards, Dones, DeltaTimes, ResetRows, Episodes;
+        for (const FStepResult& SR : MakeArrayView(Results, Num))
+        {
+            TArray<TSharedPtr<FJsonValue>> Row;
+            for (float v : SR.Obs) Row.Add(MakeShared<FJsonValueNumber>(v));
+            ObsRows.Add(MakeShared<FJsonValueArray>(Row));
+            Rewards.Add(MakeShared<FJsonValueNumber>(SR.Reward));
+            Dones.Add(MakeShared<FJsonValueBoolean>(SR.Done));
+            DeltaTimes.Add(MakeShared<FJsonValueNumber>(SR.DeltaTime));
+            if (bAutoReset)
+            {
+                // One entry per record, empty unless that record ended an episode
+                TArray<TSharedPtr<FJsonValue>> ResetRow;
+                if (SR.Done)
+                    for (float v : SR.ResetObs) ResetRow.Add(MakeShared<FJsonValueNumber>(v));
+                ResetRows.Add(MakeShared<FJsonValueArray>(ResetRow));
+            }
+            if (bEpisodeStats)
+            {
+                // null unless that record ended an episode
+                Episodes.Add(SR.Done ? TSharedPtr<FJsonValue>(MakeShared<FJsonValueObject>(EpisodeJson(SR.Episode)))
+                                     : TSharedPtr<FJsonValue>(MakeShared<FJsonValueNull>()));
+            }
+        }
+        Resp->SetNumberField(TEXT("count"), Num);
+        Resp->SetArrayField(TEXT("obs"), ObsRows);
+        Resp->SetArrayField(TEXT("reward"), Rewards);
+        Resp->SetArrayField(TEXT("done"), Dones);
+        Resp->SetArrayField(TEXT("delta_time"), DeltaTimes);
+        if (bAutoReset)
+            Resp->SetArrayField(TEXT("reset_obs"), ResetRows);
+        if (bEpisodeStats)
+            Resp->SetArrayField(TEXT("episodes"), Episodes);
+        return SendJson(Conn, Resp);
+    }
+
+    if (Encoding == EEnvEncoding::SharedMemory && FitsRing(Results, Num))
+        return SendViaRing(Conn, Results, Num, Kind);
+
+    size_t Size = sizeof(EnvWire::FFrameHeader) + sizeof(EnvWire::FTimingBlock);
+    for (const FStepResult& SR : MakeArrayView(Results, Num))
+        Size += RecordMaxSize(SR);
+    FrameBuffer.SetNumUninitialized(EnvWire::LengthPrefixSize + Size, EAllowShrinking::No);
+
+    uint8* Payload = FrameBuffer.GetData() + EnvWire::LengthPrefixSize;
+    uint8* Cursor = EnvWire::WriteFrameHeader(Payload, Kind, FrameFlags(), Num);
+    Cursor = WriteTimingBlock(Cursor);
+    for (const FStepResult& SR : MakeArrayView(Results, Num))
+        Cursor = WriteRecord(Cursor, SR);
+
+    const int32 PayloadLen = static_cast<int32>(Cursor - Payload);
+    const int32 CompressedLen = CompressFrame(PayloadLen);
+    if (CompressedLen > 0)
+        return SendFrame(Conn, CompressBuffer.GetData(), CompressedLen);
+    return SendFrame(Conn, FrameBuffer.GetData(), PayloadLen);
+}
+
+int32 UTCPEnvSubsystem::CompressFrame(int32 PayloadLen)
+{
+    constexpr int32 HeaderSize = sizeof(EnvWire::FFrameHeader);
+    constexpr int32 BlockSize = sizeof(EnvWire::FCompressedBlock);
+    const int32 BodyLen = PayloadLen - HeaderSize;
+    if (CompressionCodec != EnvWire::ECodec::Zlib || BodyLen <= 0 || static_cast<uint32>(BodyLen) < CompressThreshold)
+        return 0;
+
+    const uint8* Payload = FrameBuffer.GetData() + EnvWire::LengthPrefixSize;
+    int32 CompressedLen = FCompression::CompressMemoryBound(NAME_Zlib, BodyLen);
+    CompressBuffer.SetNumUninitialized(EnvWire::LengthPrefixSize + HeaderSize + BlockSize + CompressedLen, EAllowShrinking::No);
+    uint8* Out = CompressBuffer.GetData() + EnvWire::LengthPrefixSize;
+
+    // Speed over ratio, this runs on the reply path of every large batch
+    if (!FCompression::CompressMemory(NAME_Zlib, Out + HeaderSize + BlockSize, CompressedLen, Payload + HeaderSize, BodyLen, COMPRESS_BiasSpeed))
+        return 0;
+    if (HeaderSize + BlockSize + CompressedLen >= PayloadLen)
+        return 0;
+
+    EnvWire::FFrameHeader H;
+    FMemory::Memcpy(&H, Payload, HeaderSize);
+    H.Flags |= EnvWire::FlagCompressed;
+    FMemory::Memcpy(Out, &H, HeaderSize);
+
+    EnvWire::FCompressedBlock Block = {};
+    Block.RawSize = static_cast<uint32>(BodyLen);
+    Block.Codec = static_cast<uint8>(EnvWire::ECodec::Zlib);
+    FMemory::Memcpy(Out + HeaderSize, &Block, BlockSize);
+    return HeaderSize + BlockSize + CompressedLen;
+}
+
+uint16 UTCPEnvSubsystem::FrameFlags() const
+{
+    return (bPackedGrid ? EnvWire::FlagPackedGrid : 0) | (bTimingBlock ? EnvWire::FlagTimingBlock : 0) |
+        (bAutoReset ? EnvWire::FlagAutoReset : 0) | (bEpisodeStats ? EnvWire::FlagEpisodeStats : 0);
+}
+
+uint8* UTCPEnvSubsystem::WriteTimingBlock(uint8* Dst) const
+{
+    if (!bTimingBlock)
+        return Dst;
+    const EnvWire::FTimingBlock T = MakeTimingBlock();
+    FMemory::Memcpy(Dst, &T, sizeof(T));
+    return Dst + sizeof(T);
+}
+
+EnvWire::FTimingBlock UTCPEnvSubsystem::MakeTimingBlock() const
+{
+    EnvWire::FTimingBlock T = {};
+    T.RecvUs = CyclesToMicros(Timing.RecvStart, Timing.Parsed);
+    if (Timing.Enqueued != 0)
+    {
+        // Only meaningful when this request actually went through the game thread
+        T.QueueUs = CyclesToMicros(Timing.Enqueued, Command.ExecStartCycles);
+        T.ExecuteUs = CyclesToMicros(Command.ExecStartCycles, Command.ExecEndCycles);
+        T.WakeUs = CyclesToMicros(Command.ExecEndCycles, Timing.Completed);
+    }
+    T.PrevEncodeUs = LastEncodeUs;
+    T.PrevSendUs = LastSendUs;
+    return T;
+}
+
+void UTCPEnvSubsystem::RecordRequestTiming(const FString& Cmd)
+{
+    // Command names are plain ASCII; EnvTelemetry::Commands is the one table both servers share
+    const int32 CmdIndex = EnvTelemetry::CommandIndex(TCHAR_TO_ANSI(*Cmd));
+
+    LastEncodeUs = CyclesToMicros(Timing.EncodeStart, Timing.SendStart);
+    LastSendUs = CyclesToMicros(Timing.SendStart, Timing.SendEnd);
+
+    if (Timing.SendEnd != 0)
+    {
+        using EnvTelemetry::EPhase;
+        EnvTelemetry::FLatencyHistogram* H = &LatencyHistograms[CmdIndex * NumPhases];
+        const bool bGameThread = Timing.Enqueued != 0;
+        const EnvWire::FTimingBlock T = MakeTimingBlock();
+
+        H[int32(EPhase::Recv)].Record(T.RecvUs);
+        if (bGameThread)
+        {
+            H[int32(EPhase::Queue)].Record(T.QueueUs);
+            H[int32(EPhase::Execute)].Record(T.ExecuteUs);
+            H[int32(EPhase::Wake)].Record(T.WakeUs);
+        }
+        H[int32(EPhase::Encode)].Record(LastEncodeUs);
+        H[int32(EPhase::Send)].Record(LastSendUs);
+        H[int32(EPhase::Total)].Record(CyclesToMicros(Timing.RecvStart, Timing.SendEnd));
+    }
+}
+
+TSharedPtr<FJsonObject> UTCPEnvSubsystem::BuildStatsJson() const
+{
+    TSharedPtr<FJsonObject> Stats = MakeShared<FJsonObject>();
+    for (int32 c = 0; c < EnvTelemetry::NumCommands; ++c)
+    {
+        TSharedPtr<FJsonObject> CmdObj;
+        for (int32 p = 0; p < NumPhases; ++p)
+        {
+            const EnvTelemetry::FLatencyHistogram& H = LatencyHistograms[c * NumPhases + p];
+            if (H.GetCount() == 0)
+                continue;
+
+            TSharedPtr<FJsonObject> PhaseObj = MakeShared<FJsonObject>();
+            PhaseObj->SetNumberField(TEXT("count"), double(H.GetCount()));
+            PhaseObj->SetNumberField(TEXT("mean_us"), H.GetMean());
+            PhaseObj->SetNumberField(TEXT("min_us"), double(H.GetMin()));
+            PhaseObj->SetNumberField(TEXT("p50_us"), double(H.GetPercentile(50.0)));
+            PhaseObj->SetNumberField(TEXT("p90_us"), double(H.GetPercentile(90.0)));
+            PhaseObj->SetNumberField(TEXT("p99_us"), double(H.GetPercentile(99.0)));
+            PhaseObj->SetNumberField(TEXT("p999_us"), double(H.GetPercentile(99.9)));
+            PhaseObj->SetNumberField(TEXT("max_us"), double(H.GetMax()));
+
+            if (!CmdObj)
+                CmdObj = MakeShared<FJsonObject>();
+            CmdObj->SetObjectField(ANSI_TO_TCHAR(EnvTelemetry::PhaseName(static_cast<EnvTelemetry::EPhase>(p))), PhaseObj);
+        }
+        if (CmdObj)
+            Stats->SetObjectField(ANSI_TO_TCHAR(EnvTelemetry::Commands[c]), CmdObj);
+    }
+    return Stats;
+}
+
+size_t UTCPEnvSubsystem::RecordMaxSize(const FStepResult& SR) const
+{
+    const uint32 ObsLen = static_cast<uint32>(SR.Obs.Num());
+    size_t Size = bPackedGrid ? EnvWire::PackedStepRecordMaxSize(ObsLen, GridLength(SR.Obs.Num())) : EnvWire::StepRecordSize(ObsLen);
+    if (bEpisodeStats && SR.Done)
+        Size += sizeof(EnvWire::FEpisodeSummary);
+    if (bAutoReset && SR.Done)
+    {
+        const uint32 ResetLen = static_cast<uint32>(SR.ResetObs.Num());
+        Size += bPackedGrid ? EnvWire::PackedStepRecordMaxSize(ResetLen, GridLength(SR.ResetObs.Num())) : EnvWire::StepRecordSize(ResetLen);
+    }
+    return Size;
+}
+
+uint8* UTCPEnvSubsystem::WriteRecord(uint8* Dst, const FStepResult& SR) const
+{
+    Dst = bPackedGrid
+        ? EnvWire::WritePackedStepRecord(Dst, SR.Reward, SR.Done, SR.DeltaTime, SR.Obs.GetData(), SR.Obs.Num(), GridLength(SR.Obs.Num()))
+        : EnvWire::WriteStepRecord(Dst, SR.Reward, SR.Done, SR.DeltaTime, SR.Obs.GetData(), SR.Obs.Num());
+
+    // FlagEpisodeStats: the finished episode's summary comes first, then any reset record
+    if (bEpisodeStats && SR.Done)
+    {
+        FMemory::Memcpy(Dst, &SR.Episode, sizeof(SR.Episode));
+        Dst += sizeof(SR.Episode);
+    }
+
+    // FlagAutoReset: the new episode's first observation rides along, laid out like a reset reply
+    if (bAutoReset && SR.Done)
+    {
+        Dst = bPackedGrid
+            ? EnvWire::WritePackedStepRecord(Dst, 0.0f, false, 0.0f, SR.ResetObs.GetData(), SR.ResetObs.Num(), GridLength(SR.ResetObs.Num()))
+            : EnvWire::WriteStepRecord(Dst, 0.0f, false, 0.0f, SR.ResetObs.GetData(), SR.ResetObs.Num());
+    }
+    return Dst;
+}
+
+uint32 UTCPEnvSubsystem::GridLength(int32 ObsLen)
+{
+    // Everything in front of the scalar tail is the peripheral flag grid
+    return static_cast<uint32>(FMath::Max(ObsLen - AObservationManager::NumScalarFeatures, 0));
+}
+
+void UTCPEnvSubsystem::EnsureVecEnvs()
+{
+    UWorld* World = EnvWorld.Get();
+    if (!World || !Env)
+        return;
+
+    if (VecEnvs.Num() == 0)
+        VecEnvs.Add(Env);
+
+    // Instances are discovered from the "Env<K>" pawn tags, so late spawns get picked up too
+    const int32 Count = EnvInstance::CountInstances(World);
+    while (VecEnvs.Num() < Count)
+    {
+        UUE5Game* VecEnv = NewObject<UUE5Game>(this);
+        VecEnv->AddToRoot();
+        VecEnv->Initialize(World, VecEnvs.Num());
+        VecEnv->SetAutoReset(Env->GetAutoReset());
+        VecEnv->SetActionRepeat(Env->GetActionRepeat());
+        VecEnvs.Add(VecEnv);
+        UE_LOG(LogTemp, Log, TEXT("TCPEnvSubsystem: Vectorized env %d initialized"), VecEnv->GetEnvIndex());
+    }
+}
+
+UUE5Game* UTCPEnvSubsystem::GetEnvInstance(int32 EnvIndex)
+{
+    if (EnvIndex == 0)
+        return Env;
+    EnsureVecEnvs();
+    return VecEnvs.IsValidIndex(EnvIndex) ? VecEnvs[EnvIndex] : nullptr;
+}
+
+UUE5Game* UTCPEnvSubsystem::CommandEnv(FEnvCommand& Cmd)
+{
+    UUE5Game* Target = GetEnvInstance(Cmd.EnvIndex);
+    if (!Target)
+    {
+        EnsureVecEnvs();
+        Cmd.bNoSuchEnv = true;
+        Cmd.NumEnvs = VecEnvs.Num();
+    }
+    return Target;
+}
+
+void UTCPEnvSubsystem::SetAutoReset(bool bEnable)
+{
+    Env->SetAutoReset(bEnable);
+    for (UUE5Game* VecEnv : VecEnvs)
+        VecEnv->SetAutoReset(bEnable);
+}
+
+void UTCPEnvSubsystem::SetActionRepeat(int32 Repeat)
+{
+    Env->SetActionRepeat(Repeat);
+    for (UUE5Game* VecEnv : VecEnvs)
+        VecEnv->SetActionRepeat(Repeat);
+}
+
+bool UTCPEnvSubsystem::ReapplyLockStepAction(FEnvCommand& Cmd, UUE5Game* Target)
+{
+    // Instances that finished early just sit out the remaining ticks of a vec step
+    bool bAny = false;
+    for (int32 i = 0; i < Cmd.RepeatingEnvs.Num(); ++i)
+    {
+        if (!Cmd.RepeatingEnvs[i])
+            continue;
+        UUE5Game* Instance = Target ? Target : VecEnvs[i];
+        if (Instance->IsRepeatCutShort())
+        {
+            Cmd.RepeatingEnvs[i] = false;
+            continue;
+        }
+        const FEnvAction& A = Target ? Cmd.Actions[Cmd.Next - 1] : Cmd.Actions[i];
+        Cmd.RepeatingEnvs[i] = !Instance->ApplyRepeatedAction(A.Pitch, A.Yaw, A.Fire);
+        bAny = true;
+    }
+    return bAny;
+}
+
+bool UTCPEnvSubsystem::FitsRing(const FStepResult* Results, int32 Num) const
+{
+    if (!ShmRing.IsOpen() || Num <= 0)
+        return false;
+    uint32 Slots = 0;
+    for (int32 i = 0; i < Num; ++i)
+    {
+        const bool bResetRecord = bAutoReset && Results[i].Done;
+        if (static_cast<uint32>(Results[i].Obs.Num()) > ShmRing.GetObsCapacity() ||
+            (bResetRecord && static_cast<uint32>(Results[i].ResetObs.Num()) > ShmRing.GetObsCapacity()))
+            return false;
+        Slots += bResetRecord ? 2 : 1;
+    }
+    return Slots <= ShmRing.GetSlotCount();
+}
+
+bool UTCPEnvSubsystem::SendViaRing(FEnvConnection& Conn, const FStepResult* Results, int32 Num, EnvWire::EFrameKind Kind)
+{
+    // Copies results that had to be built in FStepResults first (a vec_step under action repeat finishes its
+    // instances out of order); everything else was stepped into the slots in place, see FillNextResult
+    uint32 FirstSlot = 0;
+    for (int32 i = 0; i < Num; ++i)
+    {
+        const FStepResult& SR = Results[i];
+        const uint32 Slot = ShmRing.WriteRecord(SR.Reward, SR.Done, SR.DeltaTime, SR.Obs.GetData(), SR.Obs.Num());
+        if (i == 0)
+            FirstSlot = Slot;
+        if (bAutoReset && SR.Done)
+            ShmRing.WriteRecord(0.0f, false, 0.0f, SR.ResetObs.GetData(), SR.ResetObs.Num());
+    }
+    return SendSlotNotice(Conn, FirstSlot, Num, Kind);
+}
 
-    // Payload
-    Socket->Send(reinterpret_cast<const uint8*>(Converter.Get()), Len, Sent);
+bool UTCPEnvSubsystem::SendCommandResults(FEnvConnection& Conn, const FEnvCommand& Cmd, EnvWire::EFrameKind Kind)
+{
+    if (Cmd.bToRing)
+    {
+        Timing.EncodeStart = FPlatformTime::Cycles64();
+        return SendSlotNotice(Conn, Cmd.FirstRingSlot, Cmd.NumResults, Kind);
+    }
+    if (Kind == EnvWire::EFrameKind::Step)
+        return SendStepResult(Conn, Cmd.Results[0]);
+    return SendResultBatch(Conn, Cmd.Results.GetData(), Cmd.NumResults, Kind);
+}
+
+void UTCPEnvSubsystem::PlanRingReply(FEnvCommand& Cmd, UUE5Game& Instance, int32 MaxResults) const
+{
+    if (Cmd.NumResults > 0 || !Cmd.bRingAllowed || !ShmRing.IsOpen())
+        return;
+    // A reply can't wrap onto its own first records, and every observation has to fit a slot
+    Instance.BindManagers();
+    const int64 Records = int64(FMath::Max(MaxResults, 1)) * (Cmd.bAutoReset ? 2 : 1);
+    Cmd.bToRing = Records <= int64(ShmRing.GetSlotCount())
+        && static_cast<uint32>(Instance.GetObservationLength()) <= ShmRing.GetObsCapacity();
+}
+
+bool UTCPEnvSubsystem::SendSlotNotice(FEnvConnection& Conn, uint32 FirstSlot, int32 Num, EnvWire::EFrameKind Kind)
+{
+    // Doorbell: 20 bytes instead of the whole observation
+    constexpr int32 NoticeLen = sizeof(EnvWire::FFrameHeader) + sizeof(EnvShm::FSlotNotice);
+    uint8 Notice[EnvWire::LengthPrefixSize + NoticeLen];
+    EnvShm::WriteSlotNotice(Notice + EnvWire::LengthPrefixSize, FirstSlot, Num, Kind, bAutoReset ? EnvWire::FlagAutoReset : 0);
+    return SendFrame(Conn, Notice, NoticeLen);
+}
+
+bool UTCPEnvSubsystem::SendFrame(FEnvConnection& Conn, uint8* Frame, int32 PayloadLen)
+{
+    // Little-endian length header to match Python struct.pack('<I', ...)
+    EnvWire::WriteLengthPrefix(Frame, static_cast<uint32>(PayloadLen));
+    FScopeLock Lock(&SendLock);
+    Timing.SendStart = FPlatformTime::Cycles64();
+    const bool bSent = SendAll(Conn, Frame, EnvWire::LengthPrefixSize + PayloadLen);
+    Timing.SendEnd = FPlatformTime::Cycles64();
+    return bSent;
+}
+
+bool UTCPEnvSubsystem::SendAll(FEnvConnection& Conn, const uint8* Data, int32 Len)
+{
+    int32 Total = 0;
+    while (Total < Len)
+    {
+        int32 Sent = 0;
+        if (!Conn.Send(Data + Total, Len - Total, Sent) || Sent < 0)
+            return false;
+        Total += Sent;
+    }
     return true;
 }
 
-TSharedPtr<FJsonObject> UTCPEnvSubsystem::ReceiveJson(FSocket* Socket)
+bool UTCPEnvSubsystem::RecvAll(FEnvConnection& Conn, uint8* Dst, int32 Len)
+{
+    int32 Total = 0;
+    while (Total < Len)
+    {
+        int32 Read = 0;
+        if (!Conn.Recv(Dst + Total, Len - Total, Read))
+            return false;
+        if (Read <= 0)
+        {
+            // Nothing this time; only keep waiting while the peer is still there
+            if (bShouldStop.load() || !Conn.IsConnected())
+                return false;
+            continue;
+        }
+        Total += Read;
+    }
+    return true;
+}
+
+TSharedPtr<FJsonObject> UTCPEnvSubsystem::ReceiveJson(FEnvConnection& Conn)
 {
     // Read 4-byte little-endian length
-    uint32_t Len = 0;
-    int32 Recv = 0;
-    if (!Socket->Recv(reinterpret_cast<uint8*>(&Len), sizeof(Len), Recv) || Recv != sizeof(Len))
+    uint32 Len = 0;
+    if (!RecvAll(Conn, reinterpret_cast<uint8*>(&Len), sizeof(Len)))
         return nullptr;
 
-    // Read payload
-    TArray<uint8> Buf;
-    Buf.SetNumUninitialized(Len + 1);
-    if (!Socket->Recv(Buf.GetData(), Len, Recv) || Recv != (int32)Len)
+    // A new request starts once its prefix is in; time spent idle before that isn't ours
+    Timing = FRequestTiming();
+    Timing.RecvStart = FPlatformTime::Cycles64();
+    if (Len > EnvWire::MaxPayloadSize)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("TCPEnvSubsystem: Dropping client, request of %u bytes exceeds the limit"), Len);
+        return nullptr;
+    }
+
+    // Read payload into the connection buffer, grown once and then reused
+    RecvBuffer.SetNumUninitialized(Len, EAllowShrinking::No);
+    if (!RecvAll(Conn, RecvBuffer.GetData(), Len))
         return nullptr;
-    Buf[Len] = 0;
 
-    // Parse JSON
-    FString JsonStr = FString(UTF8_TO_TCHAR(Buf.GetData()));
+    // Parse the UTF-8 bytes in place
+    FMemoryReaderView Ar(MakeArrayView(RecvBuffer.GetData(), Len));
     TSharedPtr<FJsonObject> Obj;
-    TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonStr);
+    TSharedRef<TJsonReader<UTF8CHAR>> Reader = TJsonReaderFactory<UTF8CHAR>::Create(&Ar);
     if (FJsonSerializer::Deserialize(Reader, Obj))
         return Obj;
 
     return nullptr;
 }
 
+FString UTCPEnvSubsystem::DescribeEndpoint() const
+{
+    char Text[192];
+    EnvEndpoint::Format(ListenEndpoint, Text, sizeof(Text));
+    return ANSI_TO_TCHAR(Text);
+}
+
 void UTCPEnvSubsystem::ResetEpisode()
 {
     if (Env)
@@ -4,14 +4,16 @@
 #include "AObservationManager.h"
 #include "ARewardManager.h"
 #include "ADoneManager.h"
+#include "EnvInstanceTags.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/Controller.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "HAL/PlatformTime.h"
 #include "Engine/World.h"
 #include "Engine/Engine.h"
 
 UUE5Game::UUE5Game()
     : World(nullptr)
+    , EnvIndex(0)
     , PC(nullptr)
     , Character(nullptr)
     , MoveComp(nullptr)
@@ -25,17 +27,18 @@ UUE5Game::UUE5Game()
 {
 }
 
-void UUE5Game::Initialize(UWorld* InWorld)
+void UUE5Game::Initialize(UWorld* InWorld, int32 InEnvIndex)
 {
     World = InWorld;
+    EnvIndex = InEnvIndex;
     if (!World) return;
 
-    PC = UGameplayStatics::GetPlayerController(World, 0);
-    if (!PC) return;
-
-    Character = Cast<ACharacter>(PC->GetPawn());
+    Character = Cast<ACharacter>(EnvInstance::FindAgentPawn(World, EnvIndex));
     if (!Character) return;
 
+    PC = Character->GetController();
+    if (!PC) return;
+
     MoveComp = Character->GetCharacterMovement();
     Character->bUseControllerRotationYaw = true;
     Character->bUseControllerRotationPitch = false;
@@ -49,24 +52,177 @@ void UUE5Game::BindManagers()
 {
     if (bManagersBound || !World) return;
 
-    ObservationManager = Cast<AObservationManager>(
-        UGameplayStatics::GetActorOfClass(World, AObservationManager::StaticClass()));
-    RewardManager = Cast<ARewardManager>(
-        UGameplayStatics::GetActorOfClass(World, ARewardManager::StaticClass()));
-    DoneManager = Cast<ADoneManager>(
-        UGameplayStatics::GetActorOfClass(World, ADoneManager::StaticClass()));
+    // Each instance only talks to the managers carrying its own "Env<K>" tag
+    ObservationManager = EnvInstance::FindActor<AObservationManager>(World, EnvIndex);
+    RewardManager = EnvInstance::FindActor<ARewardManager>(World, EnvIndex);
+    DoneManager = EnvInstance::FindActor<ADoneManager>(World, EnvIndex);
 
     bManagersBound = true;
-    UE_LOG(LogTemp, Log, TEXT("UUE5Game: Managers bound: Obs=%s, Rwd=%s, Done=%s"),
+    UE_LOG(LogTemp, Log, TEXT("UUE5Game[%d]: Managers bound: Obs=%s, Rwd=%s, Done=%s"),
+        EnvIndex,
         ObservationManager ? TEXT("OK") : TEXT("NULL"),
         RewardManager ? TEXT("OK") : TEXT("NULL"),
         DoneManager ? TEXT("OK") : TEXT("NULL"));
 }
 
 FStepResult UUE5Game::Reset()
+{
+    FStepResult Result;
+    ResetInto(Result);
+    return Result;
+}
+
+FStepResult UUE5Game::Step(float PitchDelta, float YawDelta, int32 FireFlag)
+{
+    FStepResult Result;
+    StepInto(PitchDelta, YawDelta, FireFlag, Result);
+    return Result;
+}
+
+FStepResult UUE5Game::CollectResult()
+{
+    FStepResult Result;
+    CollectResultInto(Result);
+    return Result;
+}
+
+int32 UUE5Game::GetObservationLength() const
+{
+    return ObservationManager ? ObservationManager->GetObservationLength() : 0;
+}
+
+FStepOutput UUE5Game::BindOutput(FStepResult& Out) const
+{
+    const int32 ObsLen = GetObservationLength();
+    Out.Obs.SetNumUninitialized(ObsLen, EAllowShrinking::No);
+    Out.ResetObs.SetNumUninitialized(bAutoReset ? ObsLen : 0, EAllowShrinking::No);
+
+    FStepOutput View;
+    View.Obs = Out.Obs;
+    View.ResetObs = Out.ResetObs;
+    return View;
+}
+
+void UUE5Game::FinishOutput(const FStepOutput& View, FStepResult& Out)
+{
+    Out.Reward = View.Reward;
+    Out.Done = View.Done;
+    Out.DeltaTime = View.DeltaTime;
+    Out.Episode = View.Episode;
+    // ResetObs stays empty unless the episode actually ended
+    if (!View.Done)
+    {
+        Out.ResetObs.SetNum(0, EAllowShrinking::No);
+    }
+}
+
+void UUE5Game::ResetInto(FStepResult& Out)
+{
+    BindManagers();
+    FStepOutput View = BindOutput(Out);
+    ResetInto(View);
+    FinishOutput(View, Out);
+}
+
+bool UUE5Game::StepInto(float PitchDelta, float YawDelta, int32 FireFlag, FStepResult& Out)
+{
+    if (!IsRepeatCutShort() && !ApplyRepeatedAction(PitchDelta, YawDelta, FireFlag))
+    {
+        return false;
+    }
+    CollectResultInto(Out);
+    return true;
+}
+
+void UUE5Game::CollectResultInto(FStepResult& Out)
+{
+    FStepOutput View = BindOutput(Out);
+    CollectResultInto(View);
+    FinishOutput(View, Out);
+}
+
+bool UUE5Game::RestoreSnapshotInto(int32 Slot, FStepOutput& Out)
+{
+    const FEnvSnapshot* Snapshot = Snapshots.Find(Slot);
+    if (!Snapshot)
+    {
+        return false;
+    }
+    ResetInto(Out, Snapshot);
+    return true;
+}
+
+bool UUE5Game::RestoreSnapshotInto(int32 Slot, FStepResult& Out)
+{
+    BindManagers();
+    const FEnvSnapshot* Snapshot = Snapshots.Find(Slot);
+    if (!Snapshot)
+    {
+        return false;
+    }
+    FStepOutput View = BindOutput(Out);
+    ResetInto(View, Snapshot);
+    FinishOutput(View, Out);
+    return true;
+}
+
+int32 UUE5Game::CaptureSnapshot(int32 Slot, int32 Seed)
+{
+    if (!PC || !Character)
+    {
+        Initialize(World, EnvIndex);
+    }
+
+    FEnvSnapshot& Snapshot = Snapshots.FindOrAdd(Slot);
+    EnvSnapshot::Capture(World, EnvIndex, SnapshotTags, Seed, Snapshot);
+    Snapshot.bHasAgent = PC && Character;
+    if (Snapshot.bHasAgent)
+    {
+        Snapshot.ControlRotation = PC->GetControlRotation();
+        Snapshot.AgentTransform = Character->GetActorTransform();
+    }
+    return Snapshot.Actors.Num();
+}
+
+uint64 UUE5Game::DrainEpisodeStats(TArray<EnvWire::FEpisodeSummary>& Out)
+{
+    return EpisodeSummaries.Drain([&Out](const EnvWire::FEpisodeSummary& Summary) { Out.Add(Summary); });
+}
+
+double UUE5Game::GetSimTime() const
+{
+    return World ? World->GetTimeSeconds() : 0.0;
+}
+
+EnvWire::FEpisodeSummary UUE5Game::FinishEpisode(bool bTruncated)
+{
+    const double Now = GetSimTime();
+    if (RewardManager)
+    {
+        Episode.Hits = static_cast<uint32>(RewardManager->GetEpisodeHits());
+        Episode.FirstHitTime = RewardManager->GetFirstHitTime();
+    }
+    const EnvWire::FEpisodeSummary Summary = Episode.Finish(Now, EnvIndex, bTruncated);
+    EpisodeSummaries.Push(Summary);
+    Episode.Begin(Now);
+    return Summary;
+}
+
+void UUE5Game::ResetInto(FStepOutput& Out)
+{
+    ResetInto(Out, Snapshots.Find(ResetSnapshotSlot));
+}
+
+void UUE5Game::ResetInto(FStepOutput& Out, const FEnvSnapshot* Snapshot)
 {
     BindManagers();
 
+    // 0) An episode reset before it was done still gets its summary, flagged as truncated
+    if (Episode.Length > 0)
+    {
+        FinishEpisode(true);
+    }
+
     // 1) Clear out reward manager state
     if (RewardManager)
     {
@@ -81,29 +237,67 @@ FStepResult UUE5Game::Reset()
         Character->SetActorRotation(DefaultActorSpawnRotation);
     }
 
-    // 3) Reset done flag
+    // 2b) Restore the snapshot's actors and aim over the defaults
+    if (Snapshot)
+    {
+        EnvSnapshot::Restore(World, EnvIndex, TransientSnapshotTags, *Snapshot);
+        if (Snapshot->bHasAgent && PC && Character)
+        {
+            PC->SetControlRotation(Snapshot->ControlRotation);
+            Character->SetActorTransform(Snapshot->AgentTransform, false, nullptr, ETeleportType::ResetPhysics);
+        }
+    }
+
+    // 3) Reset done flag, and drop a repeated step that was still in progress
     if (DoneManager)
     {
         DoneManager->SetCurrentDone(false);
     }
+    RepeatCount = 0;
+    RepeatDeltaTime = 0.0f;
 
-    // 4) Build result
-    FStepResult Result;
-    if (ObservationManager)
+    // 4) Build result (an empty Obs view only wants the reset, not the observation)
+    if (ObservationManager && Out.Obs.Num() > 0)
     {
-        Result.Obs = ObservationManager->GetObservation();
+        ObservationManager->WriteObservation(Out.Obs);
     }
-    Result.Reward = 0.0f;
-    Result.Done = false;
-    Result.DeltaTime = 0.0f;
-    return Result;
+    Out.Reward = 0.0f;
+    Out.Done = false;
+    Out.DeltaTime = 0.0f;
+
+    Episode.Begin(GetSimTime());
 }
 
-FStepResult UUE5Game::Step(float PitchDelta, float YawDelta, int32 FireFlag)
+bool UUE5Game::StepInto(float PitchDelta, float YawDelta, int32 FireFlag, FStepOutput& Out)
+{
+    // One application per tick; an episode that ended on one of the earlier ticks stops the repeat
+    if (!IsRepeatCutShort() && !ApplyRepeatedAction(PitchDelta, YawDelta, FireFlag))
+    {
+        return false;
+    }
+    CollectResultInto(Out);
+    return true;
+}
+
+bool UUE5Game::ApplyRepeatedAction(float PitchDelta, float YawDelta, int32 FireFlag)
+{
+    // The reward keeps piling up in the RewardManager until CollectResult polls it, so the ticks in
+    // between need no bookkeeping beyond the time they cover
+    ApplyAction(PitchDelta, YawDelta, FireFlag);
+    RepeatDeltaTime += RewardManager ? RewardManager->GetLastTickDeltaTime() : 0.0f;
+    return ++RepeatCount >= ActionRepeat;
+}
+
+bool UUE5Game::IsRepeatCutShort() const
+{
+    return RepeatCount > 0 && DoneManager && DoneManager->GetCurrentDone();
+}
+
+void UUE5Game::ApplyAction(float PitchDelta, float YawDelta, int32 FireFlag)
 {
     if (!PC || !Character)
     {
-        Initialize(World);
+        Initialize(World, EnvIndex);
     }
     BindManagers();
 
@@ -126,27 +320,47 @@ FStepResult UUE5Game::Step(float PitchDelta, float YawDelta, int32 FireFlag)
     {
         Fire();
     }
+}
 
-    FStepResult Result;
+void UUE5Game::CollectResultInto(FStepOutput& Out)
+{
     if (ObservationManager)
     {
-        Result.Obs = ObservationManager->GetObservation();
+        ObservationManager->WriteObservation(Out.Obs);
     }
-    Result.Reward = RewardManager ? RewardManager->GetCurrentReward() : 0.0f;
-    Result.Done = DoneManager ? DoneManager->GetCurrentDone() : false;
+    Out.Reward = RewardManager ? RewardManager->GetCurrentReward() : 0.0f;
+    Out.Done = DoneManager ? DoneManager->GetCurrentDone() : false;
     if (DoneManager)
     {
         DoneManager->SetCurrentDone(false);
     }
-    // 5) Propagate the engine's real DeltaTime
-    Result.DeltaTime = RewardManager ? RewardManager->GetLastTickDeltaTime() : 0.0f;
+    // 5) Propagate the engine's real DeltaTime, summed over the ticks of a repeated step
+    Out.DeltaTime = RepeatCount > 0 ? RepeatDeltaTime : (RewardManager ? RewardManager->GetLastTickDeltaTime() : 0.0f);
+    LastStepRepeats = FMath::Max(RepeatCount, 1);
+    RepeatCount = 0;
+    RepeatDeltaTime = 0.0f;
 
-    return Result;
+    // 5b) Episode statistics, before the auto-reset below starts the next episode
+    Episode.Return += Out.Reward;
+    ++Episode.Length;
+    if (Out.Done)
+    {
+        Out.Episode = FinishEpisode(false);
+    }
+
+    // 6) Auto-reset: the terminal reward is already snapshotted above, so OnEpisodeReset can't eat it
+    if (Out.Done && bAutoReset)
+    {
+        FStepOutput ResetView;
+        ResetView.Obs = Out.ResetObs;
+        ResetInto(ResetView);
+    }
 }
 
 void UUE5Game::Fire_Implementation()
 {
-    double Now = FPlatformTime::Seconds();
+    // Simulation time: dilated, fixed-step aware and frozen while paused
+    double Now = World ? World->GetTimeSeconds() : 0.0;
     double Interval = 60.0 / MaxRoundsPerMinute;
 
     if (Now - LastFireTime < Interval)
@@ -154,10 +368,12 @@ void UUE5Game::Fire_Implementation()
         UE_LOG(LogTemp, Verbose,
             TEXT("Fire blocked: %.3f/%.3f sec cooldown"),
             Now - LastFireTime, Interval);
+        ++Episode.FireBlocked;
         return;
     }
 
     LastFireTime = Now;
+    ++Episode.ShotsFired;
 
     if (DoneManager)
     {
@@ -7,6 +7,7 @@
 
 class APeripheralPyramid;
 class AFovealCone;
+class APawn;
 
 UCLASS()
 class STEELRAIN_H_API AObservationManager : public AActor
@@ -17,9 +18,18 @@ public:
     AObservationManager();
     virtual void Tick(float DeltaTime) override;
 
+    /** Scalars appended after the peripheral grid: pitch, yaw, distance, angle, overlap */
+    static constexpr int32 NumScalarFeatures = 5;
+
     /** Fetch the combined observation vector */
     TArray<float> GetObservation() const;
 
+    /** Length of the combined observation: peripheral grid + NumScalarFeatures */
+    int32 GetObservationLength() const { return PeripheralFlags.Num() + NumScalarFeatures; }
+
+    /** Writes the combined observation into caller-owned storage of GetObservationLength() floats, no allocation */
+    void WriteObservation(TArrayView<float> Out) const;
+
     /** Print & save the current observation (M key) */
     UFUNCTION()
     void SnapshotObservation();
@@ -35,12 +45,24 @@ private:
     void InitializeComponents();
     void GenerateObservation();
 
+    /** This instance's agent pawn and "Target" actor, looked up again only once the cached one is gone. */
+    APawn* FindAgent() const;
+    AActor* FindTarget() const;
+
     UPROPERTY()
     APeripheralPyramid* PeripheralPyramid;
 
     UPROPERTY()
     AFovealCone* FovealCone;
 
+    // "Env<K>" instance of this manager, from its tag at BeginPlay
+    int32 EnvIndex = 0;
+
+    // Resolved at BeginPlay; WriteObservation runs on every step, so no world scan unless they're gone
+    mutable TWeakObjectPtr<APawn> CachedAgent;
+    mutable TWeakObjectPtr<AActor> CachedTarget;
+
+    // Refilled in place every tick, so it keeps its allocation
     TArray<float> PeripheralFlags;
 
     // Hardcoded grid dimensions
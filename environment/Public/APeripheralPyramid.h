@@ -3,8 +3,19 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Engine/EngineTypes.h"
 #include "APeripheralPyramid.generated.h"
 
+/** How the peripheral grid is filled. */
+UENUM(BlueprintType)
+enum class EPeripheralSensorMode : uint8
+{
+    // One trace per cell
+    RayCast         UMETA(DisplayName = "Ray Cast"),
+    // Project the target's bounds onto the grid and trace only the cells it covers (PeripheralRaster.h)
+    AnalyticRaster  UMETA(DisplayName = "Analytic Raster"),
+};
+
 UCLASS()
 class STEELRAIN_H_API APeripheralPyramid : public AActor
 {
@@ -17,6 +28,9 @@ protected:
     virtual void BeginPlay() override;
 
 public:
+    /** Only enabled with bAsyncTraces: collects last frame's batch of async traces and queues the next one. */
+    virtual void Tick(float DeltaTime) override;
+
     /**
      * Returns a flattened array of hit flags for the peripheral grid (row-major order).
      * Length = GetWidth() * GetHeight().
@@ -24,6 +38,13 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Observation")
     TArray<float> ComputePeripheralFlags();
 
+    /**
+     * Same as ComputePeripheralFlags, written into caller-owned storage of exactly GetWidth() * GetHeight() floats.
+     * With bAsyncTraces this just copies the flags Tick last collected, which are one frame old; only when
+     * there are none yet (first frames, after a pause) does it trace synchronously.
+     */
+    void ComputePeripheralFlagsInto(TArrayView<float> OutFlags);
+
     /** Width of the peripheral grid (number of columns). */
     UFUNCTION(BlueprintCallable, Category = "Observation")
     int32 GetWidth() const;
@@ -32,6 +53,19 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Observation")
     int32 GetHeight() const;
 
+    /**
+     * Fills the grid by ray cast, by analytic raster and with the async mode's trace query (run synchronously)
+     * from the current pose, and logs every cell where either of the latter disagrees with the ray cast. With
+     * bAsyncTraces the last collected async flags are compared too; those lag a frame, so hold the pose still.
+     * Returns the number of such cells, 0 when the other modes are safe to use here.
+     */
+    UFUNCTION(BlueprintCallable, Category = "Observation")
+    int32 CheckSensorConsistency();
+
+    /** Rays actually cast per call: GetWidth() * GetHeight(), or fewer with the foveated layout. */
+    UFUNCTION(BlueprintCallable, Category = "Observation")
+    int32 GetNumTracedRays();
+
 private:
     UPROPERTY(VisibleAnywhere, Category = "Components")
     class UArrowComponent* ArrowComponent;
@@ -51,4 +85,85 @@ private:
     // Whether to draw debug rays.
     UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pyramid", meta = (AllowPrivateAccess = "true"))
     bool bShowPeripheralRays;
+
+    // Trace fewer rays, packed towards the boresight, and remap them onto the same GetWidth() x GetHeight() grid.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pyramid", meta = (AllowPrivateAccess = "true"))
+    bool bFoveatedLayout;
+
+    // Share of the grid's rays the foveated layout traces. Centre spacing matches the full grid whatever the value.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pyramid", meta = (AllowPrivateAccess = "true", ClampMin = "0.05", ClampMax = "1.0", EditCondition = "bFoveatedLayout"))
+    float FoveatedTraceFraction;
+
+    // Ray cast or analytic raster. Async traces only apply to the ray cast.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pyramid", meta = (AllowPrivateAccess = "true"))
+    EPeripheralSensorMode SensorMode;
+
+    // Trace the grid as a batch of async line traces, trading one frame of latency for not blocking the game thread.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pyramid", meta = (AllowPrivateAccess = "true"))
+    bool bAsyncTraces;
+
+    // Trace rows of the grid on the task graph's worker threads. Same flags as the serial loop, bit for bit.
+    // Off by default: only turn it on once URayUtils::ComputeRayData is known to be safe off the game thread.
+    UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Pyramid", meta = (AllowPrivateAccess = "true"))
+    bool bParallelRays;
+
+    /** Rebuilds the local ray table if the grid size, angle or foveation changed since it was built. */
+    void EnsureRayTable();
+
+    /** Rotates the local ray table into world space for the arrow's current basis, four rays per vector op. */
+    void UpdateWorldRays(const FVector& Forward, const FVector& Right, const FVector& Up);
+
+    /** World direction of grid cell Cell (row-major) as of the last UpdateWorldRays. */
+    FVector GetRayDirection(int32 Cell) const { return FVector(WorldRayX[Cell], WorldRayY[Cell], WorldRayZ[Cell]); }
+
+    /** Fills the output grid from the traced one, each output cell taking its nearest traced ray. */
+    void RemapToOutput(TArrayView<const float> Traced, TArrayView<float> OutFlags) const;
+
+    /** Runs every grid ray synchronously through URayUtils, split across worker threads with bParallelRays. */
+    void TraceSync(UWorld* World, const FVector& Origin, TArrayView<float> OutFlags);
+
+    /** Zeroes the grid, then traces only the cells whose ray enters this instance's target bounds. */
+    void RasterizeInto(UWorld* World, const FVector& Origin, const FVector& Forward, const FVector& Right, const FVector& Up, TArrayView<float> OutFlags);
+
+    /** This instance's "Target" actor, looked up again only once the cached one is gone. */
+    AActor* FindTarget(UWorld* World);
+
+    /** Reads the previous frame's batch into AsyncFlags. False, and AsyncFlags emptied, if any of it is missing. */
+    bool CollectAsyncTraces(UWorld* World);
+
+    /** The async mode's hit rule: the first blocking hit is an actor tagged "Target". */
+    static bool IsTargetHit(const FHitResult* Hit);
+
+    /** The same query as one async batch, traced synchronously: the async mode's fallback and its check. */
+    void TraceAsyncQuery(UWorld* World, const FVector& Origin, TArrayView<float> OutFlags);
+
+    /** Queues one async trace per grid cell for the world to run this frame. */
+    void SubmitAsyncTraces(UWorld* World, const FVector& Origin);
+
+    // Async mode: handles of the batch in flight, the frame it was queued on, and the last collected flags
+    // (empty until a batch has been collected)
+    TArray<FTraceHandle> PendingTraces;
+    uint64 PendingFrame = 0;
+    TArray<float> AsyncFlags;
+
+    // Unit ray directions of the traced grid, struct-of-arrays and padded to a multiple of 4. Local ones only
+    // change with the grid size, angle or foveation, world ones are refreshed from them once per call.
+    TArray<float> LocalRayX, LocalRayY, LocalRayZ;
+    TArray<float> WorldRayX, WorldRayY, WorldRayZ;
+    int32 RayTableWidth = 0;
+    int32 RayTableHeight = 0;
+    float RayTableAngle = 0.0f;
+    float RayTableFoveation = 0.0f;
+
+    // Traced grid: its size, NormX per column / NormY per row, and which traced cell each output cell reads
+    int32 TracedWidth = 0;
+    int32 TracedHeight = 0;
+    TArray<double> ColumnNorms;
+    TArray<double> RowNorms;
+    TArray<int32> OutputColumnToTraced;
+    TArray<int32> OutputRowToTraced;
+    TArray<float> TracedFlags;
+
+    TWeakObjectPtr<AActor> CachedTarget;
+    TArray<uint8> RasterCovered;
 };
@@ -36,6 +36,12 @@ public:
     UFUNCTION(BlueprintCallable, Category = "Rewards")
     void OnEpisodeReset();
 
+    /** Hits since the last OnEpisodeReset */
+    int32 GetEpisodeHits() const { return EpisodeHits; }
+
+    /** World time of this episode's first hit, negative until there is one */
+    double GetFirstHitTime() const { return FirstHitTime; }
+
     /** Enable detailed logging of reward components each tick */
     UPROPERTY(EditAnywhere, Category = "Debug")
     bool bShowDebug = true; //set to false originally
@@ -61,6 +67,10 @@ private:
     // Last tick's DeltaTime
     float LastTickDeltaTime = 0.0f;
 
+    // Episode statistics, cleared by OnEpisodeReset
+    int32 EpisodeHits = 0;
+    double FirstHitTime = -1.0;
+
     // Configurable reward values
     UPROPERTY(EditAnywhere, Category = "Rewards")
     float HitReward = 250.f;
@@ -0,0 +1,70 @@
+// EnvEndpoint.h
+#pragma once
+
+// Plain C++ like EnvWireFormat.h, so the loopback harness parses and opens endpoints the same way.
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Where the env server listens. Either a TCP address or, on Linux/Mac, a Unix domain socket
+ * path; the length-prefixed framing on top is identical. Written as a string:
+ *
+ *   "tcp://127.0.0.1:7777", "127.0.0.1:7777", "7777"      TCP
+ *   "unix:///tmp/steelrain_0.sock", "unix:rel/path.sock"   Unix domain socket
+ *
+ * The Unix helpers below work on raw file descriptors and return -1 / false on platforms
+ * without AF_UNIX support.
+ */
+namespace EnvEndpoint
+{
+    constexpr uint16_t DefaultPort = 7777;
+
+    enum class EKind : uint8_t
+    {
+        Tcp,
+        Unix,
+    };
+
+    struct FEndpoint
+    {
+        EKind    Kind = EKind::Tcp;
+        char     Host[64] = "127.0.0.1";
+        uint16_t Port = DefaultPort;
+        char     Path[108] = {};  // sockaddr_un::sun_path limit on Linux
+    };
+
+    /** Parses one of the forms above into Out. Returns false and leaves Out untouched on bad input. */
+    bool Parse(const char* Text, FEndpoint& Out);
+
+    /** Writes the canonical "tcp://host:port" / "unix://path" form of E into Buf. */
+    void Format(const FEndpoint& E, char* Buf, size_t BufLen);
+
+    /** True if this build can open Unix domain sockets. */
+    bool SupportsUnixSockets();
+
+    /** Binds and listens on Path, replacing a stale socket file. Returns a non-blocking fd or -1. */
+    int  ListenUnix(const char* Path);
+
+    /** Accepts one pending connection as a blocking fd, or returns -1 if none is waiting. */
+    int  AcceptUnix(int ListenFd);
+
+    /** Blocking connect to a listening Unix socket, -1 on failure. */
+    int  ConnectUnix(const char* Path);
+
+    /** Closes Fd and, for a listening socket, removes its file. */
+    void CloseUnix(int Fd, const char* UnlinkPath = nullptr);
+
+    /** Wakes a thread blocked in RecvSome on Fd, the way FSocket::Shutdown does. */
+    void ShutdownUnix(int Fd);
+
+    /**
+     * Same contract as FSocket::Send/Recv on a blocking socket: false on error or, for RecvSome,
+     * once the peer has closed. Interrupted calls report true with nothing transferred.
+     */
+    bool SendSome(int Fd, const uint8_t* Data, int32_t Len, int32_t& Sent);
+    bool RecvSome(int Fd, uint8_t* Dst, int32_t Len, int32_t& Read);
+
+    /** True if a write on Fd would not block right now. */
+    bool CanWriteNow(int Fd);
+}
@@ -0,0 +1,98 @@
+// EnvEpisodeStats.h
+#pragma once
+
+// Plain C++ like EnvWireFormat.h, so the loopback harness keeps its stats the same way.
+
+#include "EnvWireFormat.h"
+
+#include <cstdint>
+
+/**
+ * Episode statistics kept by the env itself, so the client doesn't have to rebuild them from
+ * the per-step stream. Only fixed-size counters are touched per step; a finished episode is
+ * folded into an FEpisodeSummary and parked in a ring until the client drains it.
+ */
+namespace EnvEpisodeStats
+{
+    /** Counters of the episode in progress. */
+    struct FCounters
+    {
+        double   Return = 0.0;
+        uint32_t Length = 0;
+        uint32_t Hits = 0;
+        uint32_t ShotsFired = 0;
+        uint32_t FireBlocked = 0;
+        double   StartTime = 0.0;
+        double   FirstHitTime = -1.0;  // simulation time of the first hit, < 0 until there is one
+
+        void Begin(double Now)
+        {
+            *this = FCounters();
+            StartTime = Now;
+        }
+
+        void AddHit(double Now)
+        {
+            if (Hits++ == 0)
+                FirstHitTime = Now;
+        }
+
+        EnvWire::FEpisodeSummary Finish(double Now, int32_t EnvIndex, bool bTruncated) const
+        {
+            EnvWire::FEpisodeSummary S;
+            S.Return = static_cast<float>(Return);
+            S.Length = Length;
+            S.Hits = Hits;
+            S.ShotsFired = ShotsFired;
+            S.FireBlocked = FireBlocked;
+            S.TimeToFirstHit = FirstHitTime >= 0.0 ? static_cast<float>(FirstHitTime - StartTime) : -1.0f;
+            S.Duration = static_cast<float>(Now - StartTime);
+            S.EnvIndex = static_cast<uint16_t>(EnvIndex);
+            S.Truncated = bTruncated ? 1 : 0;
+            S.Pad = 0;
+            return S;
+        }
+    };
+
+    /** Finished episodes waiting for the client. When full the oldest is overwritten and counted as dropped. */
+    class FSummaryRing
+    {
+    public:
+        static constexpr uint32_t Capacity = 256;
+
+        void Push(const EnvWire::FEpisodeSummary& Summary)
+        {
+            if (Count == Capacity)
+            {
+                Head = (Head + 1) % Capacity;
+                --Count;
+                ++Dropped;
+            }
+            Items[(Head + Count) % Capacity] = Summary;
+            ++Count;
+        }
+
+        /** Hands every pending summary, oldest first, to Fn and empties the ring. Returns and clears the dropped count. */
+        template <typename FnType>
+        uint64_t Drain(FnType&& Fn)
+        {
+            for (uint32_t i = 0; i < Count; ++i)
+            {
+                Fn(Items[(Head + i) % Capacity]);
+            }
+            Head = 0;
+            Count = 0;
+            const uint64_t D = Dropped;
+            Dropped = 0;
+            return D;
+        }
+
+        uint32_t Num() const { return Count; }
+
+    private:
+        EnvWire::FEpisodeSummary Items[Capacity];
+        uint32_t Head = 0;
+        uint32_t Count = 0;
+        uint64_t Dropped = 0;
+    };
+}
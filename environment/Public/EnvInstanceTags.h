@@ -0,0 +1,109 @@
+// EnvInstanceTags.h
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EngineUtils.h"
+#include "GameFramework/Actor.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+
+/**
+ * Vectorized envs share one world. Every actor belonging to instance K (agent pawn,
+ * APeripheralPyramid, AFovealCone, managers, target) carries the actor tag "Env<K>".
+ * Untagged actors count as instance 0, so the original single-turret level works unchanged.
+ */
+namespace EnvInstance
+{
+    inline FName MakeTag(int32 EnvIndex)
+    {
+        return FName(*FString::Printf(TEXT("Env%d"), EnvIndex));
+    }
+
+    /** Instance index from the actor's "Env<K>" tag, 0 if it has none. */
+    inline int32 GetIndex(const AActor* Actor)
+    {
+        if (!Actor) return 0;
+        for (const FName& Tag : Actor->Tags)
+        {
+            const FString S = Tag.ToString();
+            if (S.Len() > 3 && S.StartsWith(TEXT("Env")) && S.RightChop(3).IsNumeric())
+            {
+                return FCString::Atoi(*S.RightChop(3));
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * True if Actor belongs to instance EnvIndex, InstanceTag being MakeTag(EnvIndex) built once by the caller.
+     * Instance K > 0 is a single FName compare; only instance 0 has to parse the tags to rule the others out.
+     */
+    inline bool BelongsTo(const AActor* Actor, int32 EnvIndex, FName InstanceTag)
+    {
+        return EnvIndex == 0 ? GetIndex(Actor) == 0 : Actor->ActorHasTag(InstanceTag);
+    }
+
+    /** First actor of class T that belongs to instance EnvIndex. */
+    template <typename T>
+    T* FindActor(UWorld* World, int32 EnvIndex)
+    {
+        if (!World) return nullptr;
+        const FName InstanceTag = MakeTag(EnvIndex);
+        for (TActorIterator<T> It(World); It; ++It)
+        {
+            if (BelongsTo(*It, EnvIndex, InstanceTag))
+                return *It;
+        }
+        return nullptr;
+    }
+
+    /** First actor tagged Tag (e.g. "Target") that belongs to instance EnvIndex. */
+    inline AActor* FindTaggedActor(UWorld* World, FName Tag, int32 EnvIndex)
+    {
+        if (!World) return nullptr;
+        const FName InstanceTag = MakeTag(EnvIndex);
+        for (TActorIterator<AActor> It(World); It; ++It)
+        {
+            if (It->ActorHasTag(Tag) && BelongsTo(*It, EnvIndex, InstanceTag))
+                return *It;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Agent pawn for instance EnvIndex. Instance 0 keeps using the local player's pawn;
+     * the others are tagged pawns possessed by their own (AI) controllers.
+     */
+    inline APawn* FindAgentPawn(UWorld* World, int32 EnvIndex)
+    {
+        if (!World) return nullptr;
+        if (EnvIndex == 0)
+        {
+            if (APlayerController* PC = UGameplayStatics::GetPlayerController(World, 0))
+            {
+                if (APawn* Pawn = PC->GetPawn())
+                    return Pawn;
+            }
+        }
+        const FName Tag = MakeTag(EnvIndex);
+        for (TActorIterator<APawn> It(World); It; ++It)
+        {
+            if (It->ActorHasTag(Tag))
+                return *It;
+        }
+        return nullptr;
+    }
+
+    /** Number of env instances in the world: one past the highest "Env<K>" tag on any pawn, at least 1. */
+    inline int32 CountInstances(UWorld* World)
+    {
+        int32 Count = 1;
+        if (!World) return Count;
+        for (TActorIterator<APawn> It(World); It; ++It)
+        {
+            Count = FMath::Max(Count, GetIndex(*It) + 1);
+        }
+        return Count;
+    }
+}
@@ -0,0 +1,139 @@
+// EnvSharedMemory.h
+#pragma once
+
+// Plain C++ like EnvWireFormat.h, so the ring can be built and exercised off-engine with a stand-in env.
+
+#include <cstdint>
+#include <cstddef>
+#include "EnvWireFormat.h"
+
+/**
+ * Shared-memory transport for same-host trainers. The server maps a named region holding
+ * a ring of fixed-size transition slots and writes step records straight into it:
+ *
+ *   FRingHeader                                                  (64 bytes)
+ *   SlotCount x { EnvWire::FStepRecord (16 bytes), ObsCapacity x float32 }
+ *
+ * A producer that can build the observation in place reserves the slot with BeginRecord, writes into
+ * it and publishes it with CommitRecord; WriteRecord copies in a result that already exists elsewhere.
+ *
+ * The socket then only carries a doorbell frame (FFrameHeader with Kind == SlotNotice plus
+ * an FSlotNotice) telling the client which slots to read. Requests stay synchronous, so a slot
+ * is never rewritten before the client has seen the doorbell for it; the send on the socket
+ * orders the slot writes for the reader.
+ */
+namespace EnvShm
+{
+    // "SRSM" when read as bytes
+    constexpr uint32_t Magic = 0x4D535253u;
+    constexpr uint8_t  Version = 1;
+
+    constexpr uint32_t DefaultSlotCount = 64;
+    constexpr uint32_t DefaultObsCapacity = 2048;
+    constexpr uint32_t MaxSlotCount = 4096;
+    constexpr uint32_t MaxObsCapacity = 1u << 16;
+
+#pragma pack(push, 1)
+    struct FRingHeader
+    {
+        uint32_t Magic;
+        uint8_t  Version;
+        uint8_t  Pad0[3];
+        uint32_t SlotCount;
+        uint32_t ObsCapacity;
+        uint32_t SlotStride;
+        uint32_t Reserved;
+        uint64_t WriteSeq;   // total records ever written, slot = seq % SlotCount
+        uint8_t  Pad1[32];
+    };
+
+    /** Payload of a SlotNotice frame; the frame header's Count is the number of records. */
+    struct FSlotNotice
+    {
+        uint32_t FirstSlot;
+        uint8_t  ReplyKind;  // EnvWire::EFrameKind the records would have been sent as
+        uint8_t  Pad[3];
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FRingHeader) == 64, "FRingHeader must stay 64 bytes");
+    static_assert(sizeof(FSlotNotice) == 8, "FSlotNotice must stay 8 bytes on the wire");
+
+    /** Bytes taken by one slot for the given observation capacity. */
+    inline size_t SlotStride(uint32_t ObsCapacity)
+    {
+        return EnvWire::StepRecordSize(ObsCapacity);
+    }
+
+    /** Owner side of the ring. Creates (and on Close, removes) the named mapping. */
+    class FRing
+    {
+    public:
+        FRing() = default;
+        ~FRing() { Close(); }
+        FRing(const FRing&) = delete;
+        FRing& operator=(const FRing&) = delete;
+
+        /**
+         * Creates the mapping under Name (no leading slash; it is added on POSIX).
+         * Returns false and leaves the ring closed if the OS refuses.
+         */
+        bool Create(const char* Name, uint32_t SlotCount, uint32_t ObsCapacity);
+
+        /** Unmaps and unlinks the region. Safe to call when already closed. */
+        void Close();
+
+        bool IsOpen() const { return Base != nullptr; }
+        uint32_t GetSlotCount() const { return SlotCount; }
+        uint32_t GetObsCapacity() const { return ObsCapacity; }
+
+        /**
+         * Observation storage (GetObsCapacity() floats) of the slot Ahead records past the next one to be
+         * written, for filling in place. Nothing is published until CommitRecord, so the storage of a record
+         * that is never committed is just reused. Ahead must stay below GetSlotCount().
+         */
+        float* BeginRecord(uint32_t Ahead = 0) const
+        {
+            const uint64_t Seq = reinterpret_cast<const FRingHeader*>(Base)->WriteSeq + Ahead;
+            return reinterpret_cast<float*>(SlotData(static_cast<uint32_t>(Seq % SlotCount)) + sizeof(EnvWire::FStepRecord));
+        }
+
+        /**
+         * Writes the step header of the next slot, whose first ObsLen floats BeginRecord() already filled,
+         * and returns its index. The caller makes sure ObsLen <= GetObsCapacity().
+         */
+        uint32_t CommitRecord(float Reward, bool bDone, float DeltaTime, uint32_t ObsLen);
+
+        /** Copies one record into the next slot and returns its index; for results built somewhere else first. */
+        uint32_t WriteRecord(float Reward, bool bDone, float DeltaTime, const float* Obs, uint32_t ObsLen);
+
+    private:
+        uint8_t* SlotData(uint32_t Slot) const
+        {
+            return Base + sizeof(FRingHeader) + size_t(Slot) * SlotStride(ObsCapacity);
+        }
+
+        uint8_t* Base = nullptr;
+        size_t   Size = 0;
+        uint32_t SlotCount = 0;
+        uint32_t ObsCapacity = 0;
+        char     Name[64] = {};
+#if defined(_WIN32)
+        void*    Mapping = nullptr;
+#endif
+    };
+
+    /**
+     * Writes a SlotNotice doorbell frame at Dst, returns the first byte after it. With
+     * EnvWire::FlagAutoReset in Flags, each done record's reset record takes the slot after it.
+     */
+    inline uint8_t* WriteSlotNotice(uint8_t* Dst, uint32_t FirstSlot, uint32_t Count, EnvWire::EFrameKind ReplyKind, uint16_t Flags = 0)
+    {
+        Dst = EnvWire::WriteFrameHeader(Dst, EnvWire::EFrameKind::SlotNotice, Flags, Count);
+        FSlotNotice N = {};
+        N.FirstSlot = FirstSlot;
+        N.ReplyKind = static_cast<uint8_t>(ReplyKind);
+        std::memcpy(Dst, &N, sizeof(N));
+        return Dst + sizeof(N);
+    }
+}
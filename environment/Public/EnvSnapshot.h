@@ -0,0 +1,52 @@
+// EnvSnapshot.h
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+class UWorld;
+
+/** Restorable state of one actor. */
+struct FEnvActorState
+{
+    TWeakObjectPtr<AActor> Actor;
+    FTransform Transform;
+    FVector    LinearVelocity = FVector::ZeroVector;   // movement component, or root body if it simulates physics
+    FVector    AngularVelocity = FVector::ZeroVector;  // root body only, degrees/s
+    bool       bHidden = false;
+    TArray<uint8> SaveGameData;                        // Blueprint variables flagged "SaveGame"
+};
+
+/**
+ * World state of one env instance: every actor of that instance carrying one of the snapshot
+ * tags (target, projectiles, spawners), the agent's aim, and the RNG seed. Restoring puts the
+ * actors back in place instead of reloading the level, so a reset costs microseconds and replays
+ * the same episode for the same actions.
+ *
+ * A Blueprint opts its variables in by ticking "SaveGame" in their details (spawn counters,
+ * flight patterns, ...). Timers started with SetTimer aren't captured.
+ */
+struct FEnvSnapshot
+{
+    TArray<FEnvActorState> Actors;
+    FRotator   ControlRotation = FRotator::ZeroRotator;
+    FTransform AgentTransform;
+    bool       bHasAgent = false;
+    int32      RandomSeed = 0;
+};
+
+namespace EnvSnapshot
+{
+    /**
+     * Records every actor of instance EnvIndex that carries one of Tags into Out, then seeds the
+     * global RNG (FMath::Rand/FRand and SRand) with Seed so the draws after a capture are reproducible.
+     */
+    void Capture(UWorld* World, int32 EnvIndex, TArrayView<const FName> Tags, int32 Seed, FEnvSnapshot& Out);
+
+    /**
+     * Puts the captured actors back and re-seeds the RNG. Actors of the instance carrying one of
+     * TransientTags that weren't captured (projectiles fired since) are destroyed; captured actors
+     * that no longer exist are skipped. Returns the number of actors restored.
+     */
+    int32 Restore(UWorld* World, int32 EnvIndex, TArrayView<const FName> TransientTags, const FEnvSnapshot& Snapshot);
+}
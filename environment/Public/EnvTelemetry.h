@@ -0,0 +1,142 @@
+// EnvTelemetry.h
+#pragma once
+
+// Plain C++ like EnvWireFormat.h, so the same histograms can be used by off-engine tools.
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Per-request latency telemetry. Every request is split into phases, each recorded in
+ * microseconds into an HDR-style log-linear histogram (16 sub-buckets per power of two,
+ * so any reported percentile is within ~6% of the true value).
+ */
+namespace EnvTelemetry
+{
+    enum class EPhase : uint8_t
+    {
+        Recv,     // length prefix in -> request parsed
+        Queue,    // handed to the game thread -> game thread picks it up
+        Execute,  // game thread work (spans several ticks for step_n / lock-step)
+        Wake,     // game thread done -> listener thread running again
+        Encode,   // building the reply
+        Send,     // reply on the wire
+        Total,    // length prefix in -> reply sent
+        Count
+    };
+
+    inline const char* PhaseName(EPhase Phase)
+    {
+        static const char* Names[] = { "recv", "queue", "execute", "wake", "encode", "send", "total" };
+        return Names[static_cast<int>(Phase)];
+    }
+
+    /**
+     * Every command the env servers answer, each with its own set of phase histograms. A new command
+     * belongs in this table; until it is added its requests are counted under the trailing "other".
+     * "act" never gets a reply, so there is nothing to time for it.
+     */
+    inline constexpr const char* Commands[] = {
+        "hello", "reset", "step", "step_n", "vec_reset", "vec_step", "sync", "stats", "pause", "resume",
+        "set_time_dilation", "snapshot", "restore", "episode_stats", "stream",
+        "other" };
+    constexpr int NumCommands = static_cast<int>(sizeof(Commands) / sizeof(Commands[0]));
+
+    /** Histogram slot of a command name; unknown names share the "other" slot. */
+    inline int CommandIndex(const char* Name)
+    {
+        for (int i = 0; i < NumCommands - 1; ++i)
+        {
+            if (std::strcmp(Name, Commands[i]) == 0)
+                return i;
+        }
+        return NumCommands - 1;
+    }
+
+    class FLatencyHistogram
+    {
+    public:
+        static constexpr int SubBucketBits = 4;
+        static constexpr int SubBuckets = 1 << SubBucketBits;
+        static constexpr int MaxExponent = 40;  // ~12 days in microseconds, anything above is clamped
+        static constexpr int NumBuckets = 2 * SubBuckets + (MaxExponent - SubBucketBits - 1) * SubBuckets;
+
+        void Record(uint64_t Micros)
+        {
+            ++Counts[BucketOf(Micros)];
+            ++TotalCount;
+            Sum += Micros;
+            if (TotalCount == 1 || Micros < MinValue) MinValue = Micros;
+            if (Micros > MaxValue) MaxValue = Micros;
+        }
+
+        void Reset()
+        {
+            std::memset(Counts, 0, sizeof(Counts));
+            TotalCount = 0;
+            Sum = 0;
+            MinValue = 0;
+            MaxValue = 0;
+        }
+
+        uint64_t GetCount() const { return TotalCount; }
+        uint64_t GetMin() const { return MinValue; }
+        uint64_t GetMax() const { return MaxValue; }
+        double GetMean() const { return TotalCount ? double(Sum) / double(TotalCount) : 0.0; }
+
+        /** Lower edge of the bucket holding the given percentile (0..100), clamped to the observed range. */
+        uint64_t GetPercentile(double Percentile) const
+        {
+            if (TotalCount == 0) return 0;
+            uint64_t Rank = static_cast<uint64_t>(Percentile / 100.0 * double(TotalCount) + 0.5);
+            if (Rank < 1) Rank = 1;
+            uint64_t Seen = 0;
+            for (int i = 0; i < NumBuckets; ++i)
+            {
+                Seen += Counts[i];
+                if (Seen >= Rank)
+                {
+                    const uint64_t V = LowerBound(i);
+                    return V < MinValue ? MinValue : (V > MaxValue ? MaxValue : V);
+                }
+            }
+            return MaxValue;
+        }
+
+    private:
+        static int HighestBit(uint64_t V)
+        {
+            int Bit = 0;
+            while (V >>= 1) ++Bit;
+            return Bit;
+        }
+
+        static int BucketOf(uint64_t V)
+        {
+            if (V < uint64_t(2 * SubBuckets))
+                return static_cast<int>(V);
+            int Msb = HighestBit(V);
+            if (Msb >= MaxExponent)
+                return NumBuckets - 1;
+            const int Shift = Msb - SubBucketBits;
+            const int Sub = static_cast<int>((V >> Shift) & (SubBuckets - 1));
+            return 2 * SubBuckets + (Msb - SubBucketBits - 1) * SubBuckets + Sub;
+        }
+
+        static uint64_t LowerBound(int Index)
+        {
+            if (Index < 2 * SubBuckets)
+                return uint64_t(Index);
+            const int K = Index - 2 * SubBuckets;
+            const int Msb = K / SubBuckets + SubBucketBits + 1;
+            const int Sub = K % SubBuckets;
+            return uint64_t(SubBuckets + Sub) << (Msb - SubBucketBits);
+        }
+
+        uint64_t Counts[NumBuckets] = {};
+        uint64_t TotalCount = 0;
+        uint64_t Sum = 0;
+        uint64_t MinValue = 0;
+        uint64_t MaxValue = 0;
+    };
+}
@@ -0,0 +1,307 @@
+// EnvWireFormat.h
+#pragma once
+
+// Plain C++ on purpose (no engine headers) so the same layout can be shared with off-engine tools.
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Binary frame layout for the env RPCs. Every frame still travels behind the usual
+ * 4-byte little-endian length prefix, the binary payload just replaces the JSON text:
+ *
+ *   FFrameHeader                                          (12 bytes)
+ *   [FStreamInfo]                                         (24 bytes, Stream frames only)
+ *   [FTimingBlock]                                        (24 bytes, FlagTimingBlock)
+ *   Count x {
+ *       FStepRecord (16 bytes), observation               ObsLen x float32, or the FPackedGrid layout with FlagPackedGrid
+ *       [FEpisodeSummary]                                 (32 bytes, FlagEpisodeStats, only after a record with Done set)
+ *       [FStepRecord, observation]                        (FlagAutoReset, only after a record with Done set:
+ *                                                          the next episode's first observation, laid out like a reset reply)
+ *   }
+ *
+ * With FlagCompressed everything after FFrameHeader (timing block and records exactly as above)
+ * is replaced by an FCompressedBlock followed by the compressed bytes. A SlotNotice frame carries
+ * no records at all, they live in the shared-memory ring (EnvSharedMemory.h).
+ *
+ * All fields are little-endian; we only ship on x86-64 / ARM64 so the structs are memcpy'd as-is.
+ * A JSON payload always starts with '{', the magic below never does, so the client can tell them apart.
+ */
+namespace EnvWire
+{
+    // "SRBF" when read as bytes
+    constexpr uint32_t Magic = 0x46425253u;
+    constexpr uint8_t  Version = 1;
+
+    // Every payload, JSON or binary, goes out behind this little-endian uint32 length
+    constexpr size_t LengthPrefixSize = sizeof(uint32_t);
+
+    // Requests larger than this are treated as a broken stream rather than allocated
+    constexpr uint32_t MaxPayloadSize = 64u << 20;
+
+    enum class EFrameKind : uint8_t
+    {
+        Step = 1,        // reply to reset/step, Count == 1
+        Trajectory = 2,  // reply to step_n, one record per tick actually stepped
+        Batch = 3,       // reply to vec_reset/vec_step, one record per env instance
+        SlotNotice = 4,  // shared-memory doorbell, records live in the ring (EnvSharedMemory.h)
+        Stream = 5,      // pushed every tick in stream mode, FStreamInfo + one record, never a reply
+    };
+
+    // FFrameHeader::Flags bits
+    constexpr uint16_t FlagPackedGrid = 1u << 0;  // records use the packed layout below
+    constexpr uint16_t FlagTimingBlock = 1u << 1; // an FTimingBlock sits between the header and the records
+    constexpr uint16_t FlagCompressed = 1u << 2;  // everything after the header is an FCompressedBlock + compressed bytes
+    constexpr uint16_t FlagAutoReset = 1u << 3;   // every record with Done set is followed by the next episode's first record
+    constexpr uint16_t FlagEpisodeStats = 1u << 4; // every record with Done set is followed by an FEpisodeSummary (before any auto-reset record)
+
+    /**
+     * Compressed frames keep the 12-byte header readable and squeeze the rest (timing block and
+     * records, exactly as they would have been sent) into one stream:
+     *
+     *   FFrameHeader (Flags has FlagCompressed), FCompressedBlock, compressed bytes up to the frame end
+     *
+     * Only batched replies (Trajectory / Batch) are ever compressed, only above the threshold
+     * negotiated on "hello", and only when it actually came out smaller.
+     */
+    enum class ECodec : uint8_t
+    {
+        None = 0,
+        Zlib = 1,  // zlib stream (RFC 1950): FCompression NAME_Zlib, compress2(), Python zlib
+    };
+
+    // Below this many bytes of body a batch goes out raw unless the client asked for another threshold
+    constexpr uint32_t DefaultCompressThreshold = 16u << 10;
+
+    /**
+     * Packed records replace the leading 0/1 grid of the observation with whichever is smaller:
+     *
+     *   FStepRecord (ObsLen = full logical length), FPackedGrid,
+     *   Bitmap: ceil(GridLen / 8) bytes, LSB first    or    Sparse: Count x uint16 hit indices,
+     *   (ObsLen - GridLen) x float32 trailing scalars
+     */
+    enum class EGridMode : uint8_t
+    {
+        Bitmap = 0,
+        Sparse = 1,
+    };
+
+#pragma pack(push, 1)
+    struct FFrameHeader
+    {
+        uint32_t Magic;
+        uint8_t  Version;
+        uint8_t  Kind;
+        uint16_t Flags;
+        uint32_t Count;
+    };
+
+    struct FStepRecord
+    {
+        float    Reward;
+        float    DeltaTime;
+        uint32_t Done;
+        uint32_t ObsLen;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FFrameHeader) == 12, "FFrameHeader must stay 12 bytes on the wire");
+    static_assert(sizeof(FStepRecord) == 16, "FStepRecord must stay 16 bytes on the wire");
+
+#pragma pack(push, 1)
+    struct FPackedGrid
+    {
+        uint32_t GridLen;
+        uint16_t Count;  // hit indices that follow (Sparse only)
+        uint8_t  Mode;
+        uint8_t  Pad;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FPackedGrid) == 8, "FPackedGrid must stay 8 bytes on the wire");
+
+#pragma pack(push, 1)
+    /** Server-side phase timings in microseconds; encode/send belong to the previous reply. */
+    struct FTimingBlock
+    {
+        uint32_t RecvUs;
+        uint32_t QueueUs;
+        uint32_t ExecuteUs;
+        uint32_t WakeUs;
+        uint32_t PrevEncodeUs;
+        uint32_t PrevSendUs;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FTimingBlock) == 24, "FTimingBlock must stay 24 bytes on the wire");
+
+#pragma pack(push, 1)
+    /**
+     * Sits between the header and the record of a Stream frame. Tick ids start at 1, so an
+     * ActionTick of 0 means no new action was applied on the previous tick.
+     */
+    struct FStreamInfo
+    {
+        uint64_t Tick;           // server tick this observation was taken on
+        uint64_t ActionTick;     // tick id the client tagged the action applied on the previous tick with
+        uint32_t Superseded;     // actions replaced by a newer one before they could be applied
+        uint32_t SkippedFrames;  // frames not sent since the last one because the client wasn't reading
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FStreamInfo) == 24, "FStreamInfo must stay 24 bytes on the wire");
+
+#pragma pack(push, 1)
+    struct FCompressedBlock
+    {
+        uint32_t RawSize;  // bytes after decompression, i.e. the body of the uncompressed frame
+        uint8_t  Codec;    // ECodec
+        uint8_t  Pad[3];
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FCompressedBlock) == 8, "FCompressedBlock must stay 8 bytes on the wire");
+
+#pragma pack(push, 1)
+    /** One finished episode, as accumulated by the env (EnvEpisodeStats.h). Times are simulation seconds. */
+    struct FEpisodeSummary
+    {
+        float    Return;          // sum of the step rewards, terminal step included
+        uint32_t Length;          // steps collected
+        uint32_t Hits;
+        uint32_t ShotsFired;
+        uint32_t FireBlocked;     // fire requests eaten by the rate-of-fire cap
+        float    TimeToFirstHit;  // from reset, -1 if nothing was hit
+        float    Duration;        // from reset to the end of the episode
+        uint16_t EnvIndex;
+        uint8_t  Truncated;       // 1 if a reset cut the episode short before it was done
+        uint8_t  Pad;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FEpisodeSummary) == 32, "FEpisodeSummary must stay 32 bytes on the wire");
+
+    inline size_t GridBitmapSize(uint32_t GridLen)
+    {
+        return (size_t(GridLen) + 7) / 8;
+    }
+
+    /** Upper bound for one packed record; sparse is only picked when it beats the bitmap. */
+    inline size_t PackedStepRecordMaxSize(uint32_t ObsLen, uint32_t GridLen)
+    {
+        return sizeof(FStepRecord) + sizeof(FPackedGrid) + GridBitmapSize(GridLen) + size_t(ObsLen - GridLen) * sizeof(float);
+    }
+
+    /** Bytes needed for one step record followed by its observation. */
+    inline size_t StepRecordSize(uint32_t ObsLen)
+    {
+        return sizeof(FStepRecord) + size_t(ObsLen) * sizeof(float);
+    }
+
+    /** Writes the frame header at Dst, returns the first byte after it. */
+    inline uint8_t* WriteFrameHeader(uint8_t* Dst, EFrameKind Kind, uint16_t Flags, uint32_t Count)
+    {
+        FFrameHeader H;
+        H.Magic = Magic;
+        H.Version = Version;
+        H.Kind = static_cast<uint8_t>(Kind);
+        H.Flags = Flags;
+        H.Count = Count;
+        std::memcpy(Dst, &H, sizeof(H));
+        return Dst + sizeof(H);
+    }
+
+    /** Writes one step record plus its raw float32 observation, returns the first byte after it. */
+    inline uint8_t* WriteStepRecord(uint8_t* Dst, float Reward, bool bDone, float DeltaTime, const float* Obs, uint32_t ObsLen)
+    {
+        FStepRecord R;
+        R.Reward = Reward;
+        R.DeltaTime = DeltaTime;
+        R.Done = bDone ? 1u : 0u;
+        R.ObsLen = ObsLen;
+        std::memcpy(Dst, &R, sizeof(R));
+        Dst += sizeof(R);
+        if (ObsLen > 0)
+        {
+            std::memcpy(Dst, Obs, size_t(ObsLen) * sizeof(float));
+        }
+        return Dst + size_t(ObsLen) * sizeof(float);
+    }
+
+    /** Fills in the length prefix reserved at Frame[0..LengthPrefixSize) for a payload of PayloadLen bytes. */
+    inline void WriteLengthPrefix(uint8_t* Frame, uint32_t PayloadLen)
+    {
+        std::memcpy(Frame, &PayloadLen, LengthPrefixSize);
+    }
+
+    /**
+     * Writes one packed step record: the first GridLen values of Obs are 0/1 flags, the rest go as float32.
+     * Returns the first byte after it.
+     */
+    inline uint8_t* WritePackedStepRecord(uint8_t* Dst, float Reward, bool bDone, float DeltaTime, const float* Obs, uint32_t ObsLen, uint32_t GridLen)
+    {
+        if (GridLen > ObsLen)
+            GridLen = ObsLen;
+
+        FStepRecord R;
+        R.Reward = Reward;
+        R.DeltaTime = DeltaTime;
+        R.Done = bDone ? 1u : 0u;
+        R.ObsLen = ObsLen;
+        std::memcpy(Dst, &R, sizeof(R));
+        Dst += sizeof(R);
+
+        uint32_t Hits = 0;
+        for (uint32_t i = 0; i < GridLen; ++i)
+            Hits += Obs[i] > 0.5f ? 1u : 0u;
+
+        // uint16 indices, so very large grids always go as a bitmap
+        const bool bSparse = GridLen <= 0xFFFFu && size_t(Hits) * sizeof(uint16_t) < GridBitmapSize(GridLen);
+
+        FPackedGrid G;
+        G.GridLen = GridLen;
+        G.Count = bSparse ? static_cast<uint16_t>(Hits) : 0;
+        G.Mode = static_cast<uint8_t>(bSparse ? EGridMode::Sparse : EGridMode::Bitmap);
+        G.Pad = 0;
+        std::memcpy(Dst, &G, sizeof(G));
+        Dst += sizeof(G);
+
+        if (bSparse)
+        {
+            for (uint32_t i = 0; i < GridLen; ++i)
+            {
+                if (Obs[i] > 0.5f)
+                {
+                    const uint16_t Index = static_cast<uint16_t>(i);
+                    std::memcpy(Dst, &Index, sizeof(Index));
+                    Dst += sizeof(Index);
+                }
+            }
+        }
+        else
+        {
+            const size_t Bytes = GridBitmapSize(GridLen);
+            std::memset(Dst, 0, Bytes);
+            for (uint32_t i = 0; i < GridLen; ++i)
+            {
+                if (Obs[i] > 0.5f)
+                    Dst[i >> 3] |= uint8_t(1u << (i & 7));
+            }
+            Dst += Bytes;
+        }
+
+        const size_t ScalarBytes = size_t(ObsLen - GridLen) * sizeof(float);
+        if (ScalarBytes > 0)
+            std::memcpy(Dst, Obs + GridLen, ScalarBytes);
+        return Dst + ScalarBytes;
+    }
+
+    /** True if the payload starts with a binary frame header we understand. */
+    inline bool IsBinaryFrame(const uint8_t* Data, size_t Len)
+    {
+        if (Len < sizeof(FFrameHeader)) return false;
+        FFrameHeader H;
+        std::memcpy(&H, Data, sizeof(H));
+        return H.Magic == Magic && H.Version == Version;
+    }
+}
@@ -0,0 +1,84 @@
+// PeripheralRaster.h
+#pragma once
+
+// Plain C++ like EnvWireFormat.h, so the kernel can be benchmarked and checked in the loopback harness.
+
+#include <cstdint>
+
+/**
+ * Analytic fast path for the peripheral flag grid. Instead of casting one ray per cell, the
+ * target's collision bounds are projected onto the pyramid's image plane and only the cells
+ * whose ray actually enters the box are reported. Those few cells still need an occlusion trace
+ * in the engine; every other cell is a guaranteed miss.
+ *
+ * The ray for cell (i, j) is exactly the one APeripheralPyramid casts:
+ *   normalize(Forward + Right * NormX * HorzScale + Up * NormY * VertScale)
+ * with NormX in [-1, 1] left to right and NormY in [1, -1] top to bottom, row-major.
+ * NormX / NormY are evenly spaced unless the pyramid carries per-column / per-row tables,
+ * as the foveated layout does.
+ */
+namespace PeripheralRaster
+{
+    struct FVec3
+    {
+        double X = 0.0;
+        double Y = 0.0;
+        double Z = 0.0;
+    };
+
+    /** Axis-aligned box in world space, like AActor::GetActorBounds. */
+    struct FBox
+    {
+        FVec3 Min;
+        FVec3 Max;
+    };
+
+    struct FPyramid
+    {
+        FVec3   Origin;
+        FVec3   Forward;     // unit basis of the arrow component
+        FVec3   Right;
+        FVec3   Up;
+        int32_t Width = 0;   // columns
+        int32_t Height = 0;  // rows
+        double  HorzScale = 0.0;
+        double  VertScale = 0.0;
+        double  MaxRange = 0.0;
+        const double* ColumnNorms = nullptr;  // NormX per column, ascending; null for even spacing
+        const double* RowNorms = nullptr;     // NormY per row, descending (row 0 is the top); null for even spacing
+
+        /** Unit direction of the ray through cell (I, J). */
+        FVec3 RayDirection(int32_t I, int32_t J) const;
+    };
+
+    /**
+     * Ray-box test of one cell, over [0, MaxRange] along the ray. The box is grown by Pad on
+     * every side so float differences with the engine's own direction can't drop a boundary cell.
+     */
+    bool CellHitsBox(const FPyramid& Pyramid, const FBox& Box, int32_t I, int32_t J, double Pad);
+
+    /**
+     * Writes 1 into OutCovered[j * Width + i] for every cell whose ray enters Box within range
+     * and 0 everywhere else. Only the cells inside the box's projected rectangle are tested.
+     * Returns the number of covered cells.
+     */
+    int32_t Rasterize(const FPyramid& Pyramid, const FBox& Box, uint8_t* OutCovered, double Pad = 1.0);
+
+    /**
+     * Traced cells along an axis of OutputCells when the whole grid should trace about Fraction of its
+     * rays: sqrt(Fraction) of the axis, with the same parity as OutputCells so an odd grid keeps its
+     * boresight ray.
+     */
+    int32_t FoveatedCellCount(int32_t OutputCells, double Fraction);
+
+    /**
+     * Foveated layout along one axis: TracedCells normalized positions in [-1, 1], ascending, packed
+     * densest at the centre. The warp a*t + (1-a)*t^3 is chosen so the centre spacing equals that of
+     * OutputCells evenly spaced cells, i.e. full acuity at the boresight with fewer rays in total.
+     * TracedCells == OutputCells gives the even layout back.
+     */
+    void FoveatedNorms(int32_t OutputCells, int32_t TracedCells, double* OutNorms);
+
+    /** For each of OutputCells evenly spaced positions, the index of the nearest of the TracedCells ascending Norms. */
+    void NearestCells(const double* Norms, int32_t TracedCells, int32_t OutputCells, int32_t* OutMap);
+}
@@ -3,19 +3,189 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "Containers/CircularQueue.h"
+#include "HAL/CriticalSection.h"
+#include "UE5Game.h"
+#include "EnvWireFormat.h"
+#include "EnvSharedMemory.h"
+#include "EnvTelemetry.h"
+#include "EnvEndpoint.h"
 #include <atomic>
 #include <thread>
 #include "TCPEnvSubsystem.generated.h"
 
 class FSocket;
-class UUE5Game;
+
+/** Reply encoding for reset/step, negotiated per connection with the "hello" command. */
+enum class EEnvEncoding : uint8
+{
+    Json,
+    Binary,
+    SharedMemory  // binary records written to the shared ring, the socket only carries a doorbell
+};
+
+enum class EEnvCommandType : uint8
+{
+    Reset,
+    Step,
+    StepN,
+    VecReset,
+    VecStep,
+    Pause,
+    Resume,
+    Sync,
+    Stream,
+    TimeDilation,
+    Snapshot,
+    Restore,
+    EpisodeStats
+};
+
+/**
+ * One request handed from the listener thread to the game thread. There is only ever one in
+ * flight, so the subsystem keeps a single instance and its arrays keep their capacity.
+ * Results is a pool: only the first NumResults entries belong to the current request, and the
+ * rest keep their observation buffers for the next one (see UUE5Game::StepInto).
+ */
+struct FEnvCommand
+{
+    EEnvCommandType     Type = EEnvCommandType::Step;
+    TArray<FEnvAction>  Actions;   // Step: one, StepN: the segment, VecStep: one per env
+    TArray<FStepResult> Results;   // filled in on the game thread, pooled across requests
+    int32               NumResults = 0;
+    int32               NumEnvs = 0;
+    int32               Next = 0;  // StepN progress, one action per tick
+
+    // Reset / Step / StepN / Snapshot / Restore: the "Env<K>" instance the request targets.
+    // bNoSuchEnv comes back set (with NumEnvs filled in) if the world has no such instance
+    int32               EnvIndex = 0;
+    bool                bNoSuchEnv = false;
+
+    // Game thread timestamps (FPlatformTime::Cycles64) for the telemetry
+    uint64              ExecStartCycles = 0;
+    uint64              ExecEndCycles = 0;
+
+    // Lock-step progress: ticks still to run before the applied action's result is collected
+    int32               TicksLeft = 0;
+    bool                bApplied = false;
+
+    // Action repeat: instances (one bit each, bit 0 alone for single-env requests) whose step still
+    // holds its action for more ticks
+    TBitArray<>         RepeatingEnvs;
+
+    // Sync: requested lock-step settings
+    bool                bSyncEnable = false;
+    bool                bSyncRender = true;
+    float               SyncFixedDt = 1.0f / 60.0f;
+    int32               SyncTicksPerStep = 1;
+
+    // Stream: start or stop pushing a frame every tick
+    bool                bStreamEnable = false;
+
+    // TimeDilation: requested factor in, the one the world settings accepted back out
+    float               TimeDilation = 1.0f;
+
+    // Snapshot / Restore: slot of the EnvIndex instance. Snapshot also seeds the RNG and can make the
+    // slot that instance's reset state; SnapshotActors comes back as the actor count, -1 if nothing happened.
+    // Without bHasSnapshotSeed the game thread draws the seed itself and hands it back in SnapshotSeed.
+    int32               SnapshotSlot = 0;
+    int32               SnapshotSeed = 0;
+    bool                bHasSnapshotSeed = false;
+    bool                bSnapshotOnReset = false;
+    int32               SnapshotActors = -1;
+
+    // EpisodeStats: summaries drained from every instance (grouped by instance, oldest first within
+    // each) and how many were overwritten before anybody asked for them
+    TArray<EnvWire::FEpisodeSummary> Episodes;
+    uint64              EpisodesDropped = 0;
+
+    // Connection-wide auto-reset and action-repeat settings, copied in by the listener for every command
+    bool                bAutoReset = false;
+    int32               ActionRepeat = 1;
+
+    // Shm replies: with bRingAllowed (set by the listener) the game thread steps the results straight into
+    // ring slots, bToRing, when the whole reply fits the ring. NumResults still counts them, from FirstRingSlot on
+    bool                bRingAllowed = false;
+    bool                bToRing = false;
+    uint32              FirstRingSlot = 0;
+
+    // Done flag of the last result, wherever it was written
+    bool                bLastDone = false;
+
+    void Reset(EEnvCommandType InType)
+    {
+        Type = InType;
+        Actions.Reset();
+        NumResults = 0;
+        NumEnvs = 0;
+        Next = 0;
+        EnvIndex = 0;
+        bNoSuchEnv = false;
+        TicksLeft = 0;
+        bApplied = false;
+        ExecStartCycles = 0;
+        ExecEndCycles = 0;
+        bToRing = false;
+        FirstRingSlot = 0;
+        bLastDone = false;
+    }
+
+    /** Pooled result the next AddResult hands out, for steps that take several ticks to fill it */
+    FStepResult& PendingResult()
+    {
+        if (NumResults == Results.Num())
+            Results.AddDefaulted();
+        return Results[NumResults];
+    }
+
+    /** Next pooled result to write into; its arrays keep whatever capacity they had */
+    FStepResult& AddResult()
+    {
+        FStepResult& Result = PendingResult();
+        ++NumResults;
+        return Result;
+    }
+};
+
+/** Listener-thread timestamps (FPlatformTime::Cycles64) of the request being served. */
+struct FRequestTiming
+{
+    uint64 RecvStart = 0;
+    uint64 Parsed = 0;
+    uint64 Enqueued = 0;
+    uint64 Completed = 0;
+    uint64 EncodeStart = 0;
+    uint64 SendStart = 0;
+    uint64 SendEnd = 0;
+};
+
+/**
+ * The connected client: an engine FSocket for TCP, or a raw descriptor for a Unix domain socket
+ * (the engine's socket layer has no AF_UNIX). At most one of the two is set.
+ */
+struct FEnvConnection
+{
+    FSocket* Socket = nullptr;
+    int32    UnixFd = -1;
+
+    bool IsOpen() const { return Socket != nullptr || UnixFd >= 0; }
+    bool IsConnected() const;
+    bool Send(const uint8* Data, int32 Len, int32& Sent);
+    bool Recv(uint8* Dst, int32 Len, int32& Read);
+    bool CanWriteNow() const;
+
+    /** Unblocks a thread parked in Recv without releasing anything. */
+    void Shutdown();
+    void Close();
+};
 
 /**
  * GameInstanceSubsystem that hosts the TCP environment server
  * and persists across level loads in both PIE and Standalone.
  */
-UCLASS()
-class STEELRAIN_H_API UTCPEnvSubsystem : public UGameInstanceSubsystem
+UCLASS(Config = Game)
+class STEELRAIN_H_API UTCPEnvSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
 {
     GENERATED_BODY()
 
@@ -23,6 +193,13 @@ public:
     virtual void Initialize(FSubsystemCollectionBase& Collection) override;
     virtual void Deinitialize() override;
 
+    // FTickableGameObject: drains the command queue once per frame of the env world
+    virtual void Tick(float DeltaTime) override;
+    virtual TStatId GetStatId() const override;
+    virtual ETickableTickType GetTickableTickType() const override;
+    virtual bool IsTickableWhenPaused() const override { return true; }
+    virtual UWorld* GetTickableGameObjectWorld() const override { return EnvWorld.Get(); }
+
     /** Blueprint-callable manual reset. */
     UFUNCTION(BlueprintCallable, Category = "RL")
     void ResetEpisode();
@@ -34,14 +211,191 @@ private:
     /** Main loop: bind  listen  accept  serve JSON RPCs  repeat. */
     void ListenerThreadFunc();
 
-    bool SendJson(FSocket* Socket, const TSharedPtr<FJsonObject>& JsonObj);
-    TSharedPtr<FJsonObject> ReceiveJson(FSocket* Socket);
+    /** ListenEndpoint as "tcp://host:port" / "unix://path", for the log. */
+    FString DescribeEndpoint() const;
+
+    bool SendJson(FEnvConnection& Conn, const TSharedPtr<FJsonObject>& JsonObj);
+    TSharedPtr<FJsonObject> ReceiveJson(FEnvConnection& Conn);
+
+    /** Loops on partial reads until exactly Len bytes arrived; false on disconnect or shutdown. */
+    bool RecvAll(FEnvConnection& Conn, uint8* Dst, int32 Len);
+
+    /** Loops on partial writes until all Len bytes are on the wire. */
+    bool SendAll(FEnvConnection& Conn, const uint8* Data, int32 Len);
+
+    /** Listener thread: queues Command for the game thread and blocks until it is done. False on shutdown. */
+    bool RunOnGameThread();
+
+    /** Game thread: advances Cmd by one tick's worth of work, returns true once it is complete. */
+    bool ExecuteCommand(FEnvCommand& Cmd);
+
+    /** Game thread: lock-step version of Step/StepN/VecStep, apply -> k world ticks -> collect. */
+    bool ExecuteLockStep(FEnvCommand& Cmd);
+
+    /** Game thread: switches between free-running and lock-step simulation. */
+    void SetLockStep(bool bEnable, float FixedDt, int32 TicksPerStep, bool bRender);
+
+    /** Game thread: global time dilation of the env world. Returns the factor actually applied. */
+    float SetTimeDilation(float Dilation);
+
+    /** Game thread, stream mode: pushes this tick's observation, then applies the newest client action. */
+    void StreamTick();
+
+    /** Game thread: sends one Stream frame unless the socket can't take it without blocking. */
+    bool SendStreamFrame(const FStepResult& SR, const EnvWire::FStreamInfo& Info);
+
+    /** Sends a reset/step result in whichever encoding the client negotiated. */
+    bool SendStepResult(FEnvConnection& Conn, const FStepResult& SR);
+
+    /** Sends several step results as one reply: a step_n segment (Trajectory) or one row per env (Batch). */
+    bool SendResultBatch(FEnvConnection& Conn, const FStepResult* Results, int32 Num, EnvWire::EFrameKind Kind);
+
+    /** Game thread only: grows VecEnvs to one UUE5Game per "Env<K>" instance in the world. */
+    void EnsureVecEnvs();
+
+    /** Game thread only: Env for instance 0, otherwise the vectorized instance (nullptr if it doesn't exist). */
+    UUE5Game* GetEnvInstance(int32 EnvIndex);
+
+    /** Game thread only: the instance Cmd targets, or nullptr with Cmd.bNoSuchEnv / NumEnvs set. */
+    UUE5Game* CommandEnv(FEnvCommand& Cmd);
+
+    /**
+     * Game thread only, before Cmd's first result: picks the ring for its results if every one of up to
+     * MaxResults records (plus their auto-reset records) fits at once. Later calls keep that choice.
+     */
+    void PlanRingReply(FEnvCommand& Cmd, UUE5Game& Instance, int32 MaxResults) const;
+
+    /** Game thread only: turns auto-reset on or off for Env and every vectorized instance. */
+    void SetAutoReset(bool bEnable);
+
+    /** Game thread only: ticks per step for Env and every vectorized instance */
+    void SetActionRepeat(int32 Repeat);
+
+    /**
+     * Lock-step action repeat: once the ticks after an application have run, applies the held action
+     * again wherever the step isn't over. False when no instance needs another round.
+     */
+    bool ReapplyLockStepAction(FEnvCommand& Cmd, UUE5Game* Target);
+
+    /** Folds the finished request's timestamps into the per-command, per-phase histograms. */
+    void RecordRequestTiming(const FString& Cmd);
+
+    /** Phase timings known before the reply is encoded, for the optional per-reply timing block. */
+    EnvWire::FTimingBlock MakeTimingBlock() const;
+
+    /** JSON body of the "stats" reply. */
+    TSharedPtr<FJsonObject> BuildStatsJson() const;
+
+    /** Frame flags and per-record writer for the negotiated observation encoding. */
+    uint16 FrameFlags() const;
+    size_t RecordMaxSize(const FStepResult& SR) const;
+    uint8* WriteRecord(uint8* Dst, const FStepResult& SR) const;
+    uint8* WriteTimingBlock(uint8* Dst) const;
+    static uint32 GridLength(int32 ObsLen);
+
+    /** True if all Num results (plus their auto-reset records) fit into the shared ring in one go. */
+    bool FitsRing(const FStepResult* Results, int32 Num) const;
+
+    /** Writes the results into the shared ring and rings the doorbell on the socket. */
+    bool SendViaRing(FEnvConnection& Conn, const FStepResult* Results, int32 Num, EnvWire::EFrameKind Kind);
+
+    /** Doorbell frame for Num records from FirstSlot on that are already in the ring. */
+    bool SendSlotNotice(FEnvConnection& Conn, uint32 FirstSlot, int32 Num, EnvWire::EFrameKind Kind);
+
+    /** Replies with Cmd's results: a doorbell if the game thread put them in the ring, else encoded from Results. */
+    bool SendCommandResults(FEnvConnection& Conn, const FEnvCommand& Cmd, EnvWire::EFrameKind Kind);
+
+    /**
+     * Sends a payload whose first EnvWire::LengthPrefixSize bytes are reserved for the length prefix.
+     * The prefix is patched in place so header and payload leave in a single write.
+     */
+    bool SendFrame(FEnvConnection& Conn, uint8* Frame, int32 PayloadLen);
+
+    /**
+     * Compresses the body of the frame in FrameBuffer into CompressBuffer (same reserved prefix).
+     * Returns the compressed payload length, or 0 if the raw frame should go out instead.
+     */
+    int32 CompressFrame(int32 PayloadLen);
+
+    // Listener -> game thread hand-off. Single producer/single consumer, one command in flight
+    FEnvCommand                    Command;
+    TCircularQueue<FEnvCommand*>   CommandQueue{ 4 };
+    TCircularQueue<FEnvCommand*>   CompletionQueue{ 4 };
+    FEnvCommand*                   ActiveCommand = nullptr;
+    FEvent*                        CommandDone = nullptr;
+    FEvent*                        CommandReady = nullptr;
+
+    // Lock-step mode (game thread only). The world only advances while a step is in flight
+    bool              bLockStep = false;
+    float             LockStepDt = 1.0f / 60.0f;
+    int32             LockStepTicks = 1;
+    bool              bPrevUseFixedTimeStep = false;
+    double            PrevFixedDeltaTime = 0.0;
+    std::atomic<bool> bClientConnected{ false };
+
+    // Global time dilation set by the client (game thread only). Every env timer runs on world
+    // time, so a 4x dilation gives 4x the simulated seconds per real second with the same dynamics
+    float             TimeDilation = 1.0f;
+
+    // Stream mode: the game thread pushes a frame every tick and "act" requests never get a reply.
+    // The listener only keeps the newest action; the game thread takes it on its next tick
+    std::atomic<bool> bStreaming{ false };
+    FCriticalSection  StreamActionLock;
+    FEnvAction        PendingStreamAction;
+    uint64            PendingStreamTick = 0;    // tick id the pending action answers, 0 = none
+    uint32            SupersededActions = 0;
+    // Game thread only
+    uint64            StreamTickId = 0;
+    uint64            LastAppliedActionTick = 0;
+    uint32            SkippedStreamFrames = 0;
+    TArray<uint8>     StreamBuffer;
+    FStepResult       StreamResult;   // reused every tick, see UUE5Game::CollectResultInto
+    // Replies (listener thread) and stream frames (game thread) share the client socket
+    FCriticalSection  SendLock;
 
     std::thread       ListenerThread;
     std::atomic<bool> bShouldStop{ false };
-    int32             Port = 7777;
+
+    // Where to listen: "tcp://host:port" or "unix:///path" (EnvEndpoint.h). Set under
+    // [/Script/STEELRAIN_H.TCPEnvSubsystem] in DefaultGame.ini, or per process with -EnvEndpoint=...
+    UPROPERTY(Config)
+    FString                Endpoint = TEXT("tcp://127.0.0.1:7777");
+    EnvEndpoint::FEndpoint ListenEndpoint;
+
+    // Per-connection reply encoding, back to JSON whenever a client disconnects
+    EEnvEncoding      Encoding = EEnvEncoding::Json;
+    // Peripheral grid sent as bitmap/sparse indices instead of float32 (binary frames only)
+    bool              bPackedGrid = false;
+    // Attach a timing block to every reply (negotiated with "timing" on hello)
+    bool              bTimingBlock = false;
+    // Terminal steps reset in place and carry the next first observation (negotiated with "auto_reset" on hello)
+    bool              bAutoReset = false;
+    // Ticks each step holds its action for (negotiated with "action_repeat" on hello)
+    int32             ActionRepeat = 1;
+    // Done records carry their episode summary (negotiated with "episode_stats" on hello; not over shm)
+    bool              bEpisodeStats = false;
+    // Batched binary replies at least CompressThreshold bytes long get compressed (negotiated on hello)
+    EnvWire::ECodec   CompressionCodec = EnvWire::ECodec::None;
+    uint32            CompressThreshold = EnvWire::DefaultCompressThreshold;
+
+    // Latency telemetry, listener thread only. One histogram per tracked command and phase
+    FRequestTiming                              Timing;
+    TArray<EnvTelemetry::FLatencyHistogram>     LatencyHistograms;
+    uint32                                      LastEncodeUs = 0;
+    uint32                                      LastSendUs = 0;
+    // Per-connection buffers, reused so steady-state requests and replies don't allocate
+    TArray<uint8>     FrameBuffer;
+    TArray<uint8>     CompressBuffer;
+    TArray<uint8>     JsonSendBuffer;
+    TArray<uint8>     RecvBuffer;
+    // Same-host transport, mapped on "hello" with encoding "shm" and removed on disconnect
+    EnvShm::FRing     ShmRing;
 
     FSocket* ListenSocket = nullptr;
-    FSocket* ClientSocket = nullptr;
+    int32    UnixListenFd = -1;
+    FEnvConnection Client;
     UUE5Game* Env = nullptr;
+    // Vectorized mode: one game per env instance, VecEnvs[0] is Env itself
+    TArray<UUE5Game*> VecEnvs;
+    TWeakObjectPtr<UWorld> EnvWorld;
 };
@@ -3,10 +3,12 @@
 
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
+#include "EnvSnapshot.h"
+#include "EnvEpisodeStats.h"
 #include "UE5Game.generated.h"
 
 class UWorld;
-class APlayerController;
+class AController;
 class ACharacter;
 class UCharacterMovementComponent;
 class AObservationManager;
@@ -30,6 +32,36 @@ struct FStepResult
     // DeltaTime of the tick (0.0 on reset)
     UPROPERTY()
     float DeltaTime;
+
+    // With auto-reset on, the first observation of the next episode when Done is set (empty otherwise)
+    UPROPERTY()
+    TArray<float> ResetObs;
+
+    // Summary of the episode that just ended, only meaningful when Done is set
+    EnvWire::FEpisodeSummary Episode = {};
+};
+
+/**
+ * Caller-owned destination for the *Into calls, e.g. a transport's reused buffers or a shm slot.
+ * Nothing is allocated: Obs must hold GetObservationLength() floats, and so must ResetObs for an
+ * auto-reset observation to be kept (leave it empty to drop it).
+ */
+struct FStepOutput
+{
+    TArrayView<float> Obs;
+    TArrayView<float> ResetObs;
+    float Reward = 0.0f;
+    bool  Done = false;
+    float DeltaTime = 0.0f;
+    EnvWire::FEpisodeSummary Episode = {};  // filled in when Done is set
+};
+
+/** One agent action as it arrives over the wire: pitch/yaw deltas in degrees plus the fire flag. */
+struct FEnvAction
+{
+    float Pitch = 0.0f;
+    float Yaw = 0.0f;
+    int32 Fire = 0;
 };
 
 UCLASS(Blueprintable)
@@ -40,8 +72,10 @@ class STEELRAIN_H_API UUE5Game : public UObject
 public:
     UUE5Game();
 
-    /** Initialize with the current world */
-    void Initialize(UWorld* InWorld);
+    /** Initialize with the current world; EnvIndex picks the "Env<K>" instance to drive (0 = local player) */
+    void Initialize(UWorld* InWorld, int32 InEnvIndex = 0);
+
+    int32 GetEnvIndex() const { return EnvIndex; }
 
     /** Bind observation/reward/done managers once */
     void BindManagers();
@@ -49,9 +83,78 @@ public:
     /** Reset the environment state and return initial observation */
     FStepResult Reset();
 
-    /** Step the environment with pitch, yaw, fire_flag */
+    /**
+     * Step the environment with pitch, yaw, fire_flag. With ActionRepeat > 1 this is one tick of
+     * the step: call it again on each following tick until Obs comes back non-empty.
+     */
     FStepResult Step(float PitchDelta, float YawDelta, int32 FireFlag);
 
+    /** First half of Step: aim and fire, without reading anything back. */
+    void ApplyAction(float PitchDelta, float YawDelta, int32 FireFlag);
+
+    /** Second half of Step: observation, reward and done as of the last tick. Auto-resets on a terminal tick if enabled. */
+    FStepResult CollectResult();
+
+    /** Observation length for sizing the buffers handed to the *Into calls */
+    int32 GetObservationLength() const;
+
+    /**
+     * Allocation-free versions of Reset / Step / CollectResult; the value API above wraps these.
+     * StepInto runs one tick of the step and returns true once Out holds its result: after
+     * ActionRepeat ticks, or sooner if the episode ended. Out is left alone until then.
+     */
+    void ResetInto(FStepOutput& Out);
+    bool StepInto(float PitchDelta, float YawDelta, int32 FireFlag, FStepOutput& Out);
+    void CollectResultInto(FStepOutput& Out);
+
+    /** Same, reusing Out's arrays: they are only resized, so a result kept across steps stops allocating. */
+    void ResetInto(FStepResult& Out);
+    bool StepInto(float PitchDelta, float YawDelta, int32 FireFlag, FStepResult& Out);
+    void CollectResultInto(FStepResult& Out);
+
+    /**
+     * Action repeat (frame-skip): one Step holds its action for this many ticks, applying the clamped
+     * deltas and the fire request on each. The reward comes back summed over those ticks, DeltaTime
+     * covers all of them, and only the last observation is built.
+     */
+    void SetActionRepeat(int32 Repeat) { ActionRepeat = FMath::Max(Repeat, 1); }
+    int32 GetActionRepeat() const { return ActionRepeat; }
+
+    /**
+     * Lower level half of a repeated step for callers that tick the world themselves (lock-step):
+     * applies the action once more and returns true if that was the step's last application.
+     */
+    bool ApplyRepeatedAction(float PitchDelta, float YawDelta, int32 FireFlag);
+
+    /** True if the episode ended since the step's last application, i.e. the step should be collected now. */
+    bool IsRepeatCutShort() const;
+
+    /** Applications the last collected step got (1 without action repeat) */
+    int32 GetLastStepRepeats() const { return LastStepRepeats; }
+
+    /** When on, a terminal step resets the episode right away and returns the new first observation in ResetObs. */
+    void SetAutoReset(bool bEnable) { bAutoReset = bEnable; }
+    bool GetAutoReset() const { return bAutoReset; }
+
+    /**
+     * Records this instance's world state (SnapshotTags actors and the agent's aim) into Slot and
+     * seeds the RNG with Seed. Returns the number of actors captured.
+     */
+    int32 CaptureSnapshot(int32 Slot, int32 Seed);
+
+    /** Resets straight into Slot's state ("reset to state X"). False, with Out untouched, if the slot is empty. */
+    bool RestoreSnapshotInto(int32 Slot, FStepOutput& Out);
+    bool RestoreSnapshotInto(int32 Slot, FStepResult& Out);
+
+    /** Slot every Reset (auto-resets included) restores, INDEX_NONE to just put the pawn back. */
+    void SetResetSnapshot(int32 Slot) { ResetSnapshotSlot = Slot; }
+
+    /**
+     * Appends the summaries of the episodes finished since the last call, oldest first, and returns
+     * how many were overwritten in between because nobody drained them.
+     */
+    uint64 DrainEpisodeStats(TArray<EnvWire::FEpisodeSummary>& Out);
+
     /** Called by Step() when the fire flag is on */
     UFUNCTION(BlueprintNativeEvent, Category = "Agent|Actions")
     void Fire();
@@ -73,9 +176,30 @@ public:
     UPROPERTY(EditAnywhere, Category = "Agent|Spawn")
     FRotator DefaultActorSpawnRotation = FRotator(0.0f, 265.0f, 0.0f);
 
+    /** Actor tags a snapshot covers (within this env instance) */
+    UPROPERTY(EditAnywhere, Category = "Agent|Snapshot")
+    TArray<FName> SnapshotTags = { TEXT("Target"), TEXT("Projectile"), TEXT("Spawner") };
+
+    /** Runtime-spawned tags: such actors are destroyed on restore if the snapshot doesn't have them */
+    UPROPERTY(EditAnywhere, Category = "Agent|Snapshot")
+    TArray<FName> TransientSnapshotTags = { TEXT("Projectile") };
+
 private:
+    /** Sizes Out's arrays for the current observation and returns views over them */
+    FStepOutput BindOutput(FStepResult& Out) const;
+    static void FinishOutput(const FStepOutput& View, FStepResult& Out);
+
+    /** Reset, then restore Snapshot over the default spawn state if there is one */
+    void ResetInto(FStepOutput& Out, const FEnvSnapshot* Snapshot);
+
+    /** Folds the running counters into a summary, queues it and starts counting afresh */
+    EnvWire::FEpisodeSummary FinishEpisode(bool bTruncated);
+
+    double GetSimTime() const;
+
     UWorld* World = nullptr;
-    APlayerController* PC = nullptr;
+    int32 EnvIndex = 0;
+    AController* PC = nullptr;
     ACharacter* Character = nullptr;
     UCharacterMovementComponent* MoveComp = nullptr;
 
@@ -90,8 +214,25 @@ private:
 
     // rounds per minute cap (not exposed to editor)
     float MaxRoundsPerMinute = 840.0f;
-    // wall-clock timestamp of last shot
-    double LastFireTime = 0.0;
+    // world (simulation) time of the last shot, so the cap holds under time dilation and fixed steps.
+    // Starts far in the past so the first shot of a session is never blocked
+    double LastFireTime = -1.0e9;
 
     bool bManagersBound = false;
+
+    // Reset inside CollectResult on a terminal tick, saves the client a reset round trip
+    bool bAutoReset = false;
+
+    // Action repeat: ticks per step, applications of the step in progress and the time they covered
+    int32 ActionRepeat = 1;
+    int32 RepeatCount = 0;
+    float RepeatDeltaTime = 0.0f;
+    int32 LastStepRepeats = 1;
+
+    TMap<int32, FEnvSnapshot> Snapshots;
+    int32 ResetSnapshotSlot = INDEX_NONE;
+
+    // Episode in progress (hits come from the RewardManager) and the finished ones not drained yet
+    EnvEpisodeStats::FCounters Episode;
+    EnvEpisodeStats::FSummaryRing EpisodeSummaries;
 };